@@ -0,0 +1,226 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "engine/tinyxml2.h"
+
+using namespace std;
+using namespace tinyxml2;
+
+// Number conversions of tinyxml2's XMLUtil against the sscanf / snprintf ones it used
+// before, on a document with a million numeric attributes.
+// Usage: xml_numbers [attributes]
+
+static const int ATTRIBUTES_PER_ELEMENT = 10;
+
+// The previous conversions, kept as the reference
+static bool referenceToFloat(const char* str, float* value) {
+    return sscanf(str, "%f", value) == 1;
+}
+
+static bool referenceToDouble(const char* str, double* value) {
+    return sscanf(str, "%lf", value) == 1;
+}
+
+static bool referenceToInt(const char* str, int* value) {
+    if (XMLUtil::IsPrefixHex(str)) {
+        unsigned v;
+        if (sscanf(str, "%x", &v) == 1) {
+            *value = static_cast<int>(v);
+            return true;
+        }
+        return false;
+    }
+    return sscanf(str, "%d", value) == 1;
+}
+
+static bool referenceToUnsigned(const char* str, unsigned* value) {
+    return sscanf(str, XMLUtil::IsPrefixHex(str) ? "%x" : "%u", value) == 1;
+}
+
+static bool referenceToInt64(const char* str, int64_t* value) {
+    long long v = 0;
+    if (sscanf(str, XMLUtil::IsPrefixHex(str) ? "%llx" : "%lld", &v) != 1) return false;
+    *value = static_cast<int64_t>(v);
+    return true;
+}
+
+static bool referenceToUnsigned64(const char* str, uint64_t* value) {
+    unsigned long long v = 0;
+    if (sscanf(str, XMLUtil::IsPrefixHex(str) ? "%llx" : "%llu", &v) != 1) return false;
+    *value = static_cast<uint64_t>(v);
+    return true;
+}
+
+static int failures = 0;
+
+template <typename T>
+static void compare(const char* what, const char* str, bool (*converted)(const char*, T*),
+                    bool (*reference)(const char*, T*)) {
+    T value = T(7), expected = T(7);
+    bool ok = converted(str, &value);
+    bool expectedOk = reference(str, &expected);
+    // Bitwise, so NaN and -0 count as equal only to themselves
+    if (ok != expectedOk || memcmp(&value, &expected, sizeof(T)) != 0) {
+        cerr << what << "(\"" << str << "\") differs from sscanf" << endl;
+        failures++;
+    }
+}
+
+static void compareStr(const char* what, const char* converted, const char* reference) {
+    if (strcmp(converted, reference) != 0) {
+        cerr << what << ": \"" << converted << "\" instead of \"" << reference << "\"" << endl;
+        failures++;
+    }
+}
+
+static void checkEdgeCases() {
+    const char* inputs[] = {"0",       "-0",      "+1",    "+-1",        "-+1",      "  1.5",    "\t\n-2.25",
+                            "1.5 ",    "1.5abc",  ".5",    "-.5",        "5.",       ".",        "-",
+                            "",        "abc",     "1e",    "1e+",        "2E-",      "1e5",      "1.5e-3",
+                            "1e-50",   "1e-320",  "1e40",  "1e400",      "-1e400",   "inf",      "-inf",
+                            "nan",     "NaN",     "0x1p3", "0x10",       "0X1F",     "-0x10",    "0x",
+                            "010",     "-5",      "2147483647",          "2147483648",           "-2147483648",
+                            "-2147483649",        "4294967295",          "4294967296",           "3000000000",
+                            "9223372036854775807", "9223372036854775808", "-9223372036854775808",
+                            "18446744073709551615", "18446744073709551616", "0.1",   "3.14159265358979323846",
+                            "123456789012345678901234567890",            "1.17549435e-38",       "3.4028235e38",
+                            "0.000000000000000000000000000000000000000000001"};
+    for (const char* input : inputs) {
+        compare<float>("ToFloat", input, XMLUtil::ToFloat, referenceToFloat);
+        compare<double>("ToDouble", input, XMLUtil::ToDouble, referenceToDouble);
+        compare<int>("ToInt", input, XMLUtil::ToInt, referenceToInt);
+        compare<unsigned>("ToUnsigned", input, XMLUtil::ToUnsigned, referenceToUnsigned);
+        compare<int64_t>("ToInt64", input, XMLUtil::ToInt64, referenceToInt64);
+        compare<uint64_t>("ToUnsigned64", input, XMLUtil::ToUnsigned64, referenceToUnsigned64);
+    }
+
+    const double values[] = {0.0, -0.0, 1.0, -1.5, 0.1, 1.0 / 3.0, 1e-5, 1e-4, 123456789.0, 1e16, 1e17, 1e-300,
+                             5e-324, 1.7976931348623157e308, 3.4028235e38, 1.17549435e-38, 1e-45, 100.0, 1e8, 1e7};
+    char buffer[200], expected[200];
+    for (double value : values) {
+        XMLUtil::ToStr(value, buffer, sizeof(buffer));
+        snprintf(expected, sizeof(expected), "%.17g", value);
+        compareStr("ToStr(double)", buffer, expected);
+        float f = static_cast<float>(value);
+        XMLUtil::ToStr(f, buffer, sizeof(buffer));
+        snprintf(expected, sizeof(expected), "%.8g", f);
+        compareStr("ToStr(float)", buffer, expected);
+    }
+    const int64_t integers[] = {0, 1, -1, 2147483647, -2147483647 - 1, 9223372036854775807LL, -9223372036854775807LL - 1};
+    for (int64_t value : integers) {
+        XMLUtil::ToStr(value, buffer, sizeof(buffer));
+        snprintf(expected, sizeof(expected), "%lld", static_cast<long long>(value));
+        compareStr("ToStr(int64)", buffer, expected);
+        XMLUtil::ToStr(static_cast<int>(value), buffer, sizeof(buffer));
+        snprintf(expected, sizeof(expected), "%d", static_cast<int>(value));
+        compareStr("ToStr(int)", buffer, expected);
+        XMLUtil::ToStr(static_cast<unsigned>(value), buffer, sizeof(buffer));
+        snprintf(expected, sizeof(expected), "%u", static_cast<unsigned>(value));
+        compareStr("ToStr(unsigned)", buffer, expected);
+    }
+
+    // A buffer too short truncates like snprintf: the first three characters, then the terminator
+    const int shortSize = 4;
+    XMLUtil::ToStr(123456.0f, buffer, shortSize);
+    snprintf(expected, sizeof(expected), "%.8g", 123456.0f);
+    expected[shortSize - 1] = 0;
+    compareStr("ToStr(float) short buffer", buffer, expected);
+}
+
+static double elapsedMs(chrono::steady_clock::time_point start) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    int attributes = argc > 1 ? atoi(argv[1]) : 1000000;
+    if (attributes <= 0) {
+        cerr << "Usage: " << argv[0] << " [attributes]" << endl;
+        return 1;
+    }
+
+    checkEdgeCases();
+
+    // Values like those of the scene files and the model files
+    XMLDocument document;
+    XMLElement* root = document.NewElement("values");
+    document.InsertEndChild(root);
+    char name[16];
+    for (int i = 0; i < attributes; i++) {
+        if (i % ATTRIBUTES_PER_ELEMENT == 0) root->InsertEndChild(document.NewElement("v"));
+        float value = (i % 2 ? -1.0f : 1.0f) * (i % 1000) * 0.0137f + i * 1e-4f;
+        snprintf(name, sizeof(name), "a%d", i % ATTRIBUTES_PER_ELEMENT);
+        root->LastChildElement()->SetAttribute(name, value);
+    }
+    vector<const char*> strings;
+    strings.reserve(attributes);
+    for (XMLElement* element = root->FirstChildElement(); element; element = element->NextSiblingElement()) {
+        for (const XMLAttribute* attribute = element->FirstAttribute(); attribute; attribute = attribute->Next()) {
+            strings.push_back(attribute->Value());
+        }
+    }
+
+    // Parse every attribute both ways, the results must match
+    vector<float> parsed(strings.size()), expected(strings.size());
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < strings.size(); i++) {
+        referenceToFloat(strings[i], &expected[i]);
+    }
+    double sscanfMs = elapsedMs(start);
+
+    start = chrono::steady_clock::now();
+    size_t queried = 0;
+    for (XMLElement* element = root->FirstChildElement(); element; element = element->NextSiblingElement()) {
+        for (const XMLAttribute* attribute = element->FirstAttribute(); attribute; attribute = attribute->Next()) {
+            attribute->QueryFloatValue(&parsed[queried++]);
+        }
+    }
+    double queryMs = elapsedMs(start);
+
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < strings.size(); i++) {
+        XMLUtil::ToFloat(strings[i], &parsed[i]);
+    }
+    double toFloatMs = elapsedMs(start);
+    if (memcmp(parsed.data(), expected.data(), parsed.size() * sizeof(float)) != 0) {
+        cerr << "ToFloat results differ from sscanf" << endl;
+        failures++;
+    }
+
+    // And print them back
+    char buffer[32], reference[32];
+    start = chrono::steady_clock::now();
+    for (float value : parsed) {
+        snprintf(reference, sizeof(reference), "%.8g", value);
+    }
+    double snprintfMs = elapsedMs(start);
+
+    start = chrono::steady_clock::now();
+    for (float value : parsed) {
+        XMLUtil::ToStr(value, buffer, sizeof(buffer));
+    }
+    double toStrMs = elapsedMs(start);
+    for (size_t i = 0; i < strings.size(); i++) {
+        XMLUtil::ToStr(parsed[i], buffer, sizeof(buffer));
+        if (strcmp(buffer, strings[i]) != 0) {
+            cerr << "ToStr(" << strings[i] << ") gave " << buffer << endl;
+            failures++;
+            break;
+        }
+    }
+
+    cout << strings.size() << " attributes" << endl;
+    cout << "  sscanf %f:             " << sscanfMs << " ms" << endl;
+    cout << "  XMLUtil::ToFloat:      " << toFloatMs << " ms" << endl;
+    cout << "  QueryFloatValue:       " << queryMs << " ms" << endl;
+    cout << "  snprintf %.8g:         " << snprintfMs << " ms" << endl;
+    cout << "  XMLUtil::ToStr(float): " << toStrMs << " ms" << endl;
+    if (failures > 0) {
+        cerr << failures << " conversions differ from sscanf / snprintf" << endl;
+        return 1;
+    }
+    cout << "All conversions match sscanf / snprintf" << endl;
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "engine/tinyxml2.h"
+
+using namespace std;
+using namespace tinyxml2;
+
+// Parse the given XML files (a scene's model files) one after the other, with a new
+// document per file as before and with one document reused across them, for several
+// pool block sizes and both parse profiles, and print the pool statistics of the
+// reused document.
+// Usage: xml_pools [--rounds N] file...
+
+static double elapsedMs(chrono::steady_clock::time_point start) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+// Values are processed (entities, newlines) when they are first read
+static size_t readValues(const XMLElement* element) {
+    size_t length = 0;
+    for (; element; element = element->NextSiblingElement()) {
+        for (const XMLAttribute* attribute = element->FirstAttribute(); attribute; attribute = attribute->Next()) {
+            length += strlen(attribute->Value());
+        }
+        length += readValues(element->FirstChildElement());
+    }
+    return length;
+}
+
+// Parse and read every attribute value, as loadModel does
+static bool parse(XMLDocument& document, const string& content, const string& filename) {
+    if (document.Parse(content.data(), content.size()) != XML_SUCCESS) {
+        cerr << "Error parsing " << filename << ": " << document.ErrorStr() << endl;
+        return false;
+    }
+    return readValues(document.RootElement()) > 0;
+}
+
+int main(int argc, char* argv[]) {
+    int rounds = 5;
+    int argument = 1;
+    if (argc > 2 && string(argv[1]) == "--rounds") {
+        rounds = atoi(argv[2]);
+        argument = 3;
+    }
+    if (argument >= argc || rounds <= 0) {
+        cerr << "Usage: " << argv[0] << " [--rounds N] file..." << endl;
+        return 1;
+    }
+
+    // Read the files first so only parsing is timed
+    vector<string> files(argv + argument, argv + argc);
+    vector<string> contents;
+    size_t totalBytes = 0;
+    for (const string& filename : files) {
+        ifstream file(filename, ios::binary);
+        if (!file.is_open()) {
+            cerr << "Error opening " << filename << endl;
+            return 1;
+        }
+        contents.push_back(string(istreambuf_iterator<char>(file), istreambuf_iterator<char>()));
+        totalBytes += contents.back().size();
+    }
+    cout << files.size() << " files, " << totalBytes / 1024 << " KB, " << rounds << " rounds" << endl;
+
+    auto start = chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++) {
+        for (size_t i = 0; i < files.size(); i++) {
+            XMLDocument document;
+            if (!parse(document, contents[i], files[i])) return 1;
+        }
+    }
+    cout << "  new document per file:          " << elapsedMs(start) / rounds << " ms" << endl;
+
+    struct Setting {
+        size_t blockSize;
+        bool hugePages;
+        ParseProfile profile;
+    };
+    const Setting settings[] = {{4 * 1024, false, STANDARD_PARSE},
+                                {64 * 1024, false, STANDARD_PARSE},
+                                {1024 * 1024, false, STANDARD_PARSE},
+                                {MemPool::HUGE_PAGE_SIZE, true, STANDARD_PARSE},
+                                {64 * 1024, false, MACHINE_GENERATED_PARSE}};
+    for (const Setting& setting : settings) {
+        XMLDocument document;
+        document.SetPoolBlockSize(setting.blockSize, setting.hugePages);
+        document.SetParseProfile(setting.profile);
+        start = chrono::steady_clock::now();
+        for (int round = 0; round < rounds; round++) {
+            for (size_t i = 0; i < files.size(); i++) {
+                if (!parse(document, contents[i], files[i])) return 1;
+                document.Clear();
+            }
+        }
+        double ms = elapsedMs(start) / rounds;
+        MemPoolStats stats = document.PoolStats();
+        cout << "  reused, " << setting.blockSize / 1024 << " KB blocks" << (setting.hugePages ? " (huge pages)" : "")
+             << (setting.profile == MACHINE_GENERATED_PARSE ? ", machine-generated profile" : "") << ": " << ms << " ms; " << stats.blocks << " blocks, " << stats.blockBytes / 1024 << " KB, peak "
+             << stats.peakItems << " items (" << stats.peakItemBytes / 1024 << " KB), " << stats.allocations
+             << " allocations" << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,243 @@
+#include "animation.h"
+#include <algorithm>
+#include <iostream>
+#include <math.h>
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+using namespace std;
+
+// Coefficients of a segment: a, b, c, d with x, y, z each
+static const int SEGMENT_FLOATS = 12;
+
+static void curvePoint(const float* coef, float u, float out[3]) {
+    for (int axis = 0; axis < 3; axis++) {
+        out[axis] = ((coef[axis] * u + coef[3 + axis]) * u + coef[6 + axis]) * u + coef[9 + axis];
+    }
+}
+
+#ifndef __SSE__
+static void curveTangent(const float* coef, float u, float out[3]) {
+    for (int axis = 0; axis < 3; axis++) {
+        out[axis] = (3.0f * coef[axis] * u + 2.0f * coef[3 + axis]) * u + coef[6 + axis];
+    }
+}
+#endif
+
+// Fraction of the current lap, in [0, 1)
+static float lapFraction(double seconds, float period) {
+    double laps = seconds / period;
+    return (float) (laps - floor(laps));
+}
+
+int SceneAnimations::addCurve(const vector<Vertex>& points, float period, bool align) {
+    int count = (int) points.size();
+    if (count < 4 || period <= 0.0f) {
+        cerr << "Animated translate needs a positive time and at least 4 points" << endl;
+        return -1;
+    }
+
+    // Segment i runs from point i to point i + 1, the curve is closed
+    int firstSegment = (int) (coefficients.size() / SEGMENT_FLOATS);
+    for (int i = 0; i < count; i++) {
+        const Vertex& p0 = points[(i + count - 1) % count];
+        const Vertex& p1 = points[i];
+        const Vertex& p2 = points[(i + 1) % count];
+        const Vertex& p3 = points[(i + 2) % count];
+        const float x[4] = {p0.x, p1.x, p2.x, p3.x};
+        const float y[4] = {p0.y, p1.y, p2.y, p3.y};
+        const float z[4] = {p0.z, p1.z, p2.z, p3.z};
+        const float* axes[3] = {x, y, z};
+
+        float coef[SEGMENT_FLOATS];
+        for (int axis = 0; axis < 3; axis++) {
+            const float* p = axes[axis];
+            coef[axis] = -0.5f * p[0] + 1.5f * p[1] - 1.5f * p[2] + 0.5f * p[3];
+            coef[3 + axis] = p[0] - 2.5f * p[1] + 2.0f * p[2] - 0.5f * p[3];
+            coef[6 + axis] = -0.5f * p[0] + 0.5f * p[2];
+            coef[9 + axis] = p[1];
+        }
+        coefficients.insert(coefficients.end(), coef, coef + SEGMENT_FLOATS);
+    }
+
+    // Length along the curve at evenly spaced parameter values
+    int samples = count * SEGMENT_SAMPLES;
+    vector<float> lengths(samples + 1, 0.0f);
+    float previous[3];
+    curvePoint(&coefficients[firstSegment * SEGMENT_FLOATS], 0.0f, previous);
+    for (int j = 1; j <= samples; j++) {
+        int segment = min(j / SEGMENT_SAMPLES, count - 1);
+        float u = (float) j / SEGMENT_SAMPLES - segment;
+        float point[3];
+        curvePoint(&coefficients[(firstSegment + segment) * SEGMENT_FLOATS], u, point);
+
+        float dx = point[0] - previous[0], dy = point[1] - previous[1], dz = point[2] - previous[2];
+        lengths[j] = lengths[j - 1] + sqrtf(dx * dx + dy * dy + dz * dz);
+        copy(point, point + 3, previous);
+    }
+
+    // Invert it: the parameter at evenly spaced lengths
+    float total = lengths[samples];
+    int j = 1;
+    for (int k = 0; k <= ARC_TABLE_SIZE; k++) {
+        float target = total * k / ARC_TABLE_SIZE;
+        while (j < samples && lengths[j] < target) j++;
+
+        float span = lengths[j] - lengths[j - 1];
+        float t = span > 0.0f ? min(max((target - lengths[j - 1]) / span, 0.0f), 1.0f) : 0.0f;
+        arcTable.push_back(((j - 1) + t) / SEGMENT_SAMPLES);
+    }
+
+    int step = (int) matrices.size();
+    matrices.push_back(Mat4::identity());
+    stepSource.push_back((int) curveStep.size());
+    curveStep.push_back(step);
+    curvePeriod.push_back(period);
+    curveAlign.push_back(align);
+    curveFirstSegment.push_back(firstSegment);
+    curveSegmentCount.push_back(count);
+    positions.resize(positions.size() + 3);
+    tangents.resize(tangents.size() + 3);
+    return step;
+}
+
+int SceneAnimations::addRotation(float period, float x, float y, float z) {
+    if (period <= 0.0f || (x == 0.0f && y == 0.0f && z == 0.0f)) {
+        cerr << "Animated rotate needs a positive time and an axis" << endl;
+        return -1;
+    }
+
+    int step = (int) matrices.size();
+    matrices.push_back(Mat4::identity());
+    stepSource.push_back(-1 - (int) rotationStep.size());
+    rotationStep.push_back(step);
+    rotationPeriod.push_back(period);
+    rotationAxis.insert(rotationAxis.end(), {x, y, z});
+    return step;
+}
+
+SceneAnimations::StepInfo SceneAnimations::stepInfo(int step) const {
+    StepInfo info = {};
+    int source = stepSource[step];
+    if (source < 0) {
+        int r = -1 - source;
+        info.period = rotationPeriod[r];
+        copy(&rotationAxis[r * 3], &rotationAxis[r * 3] + 3, info.axis);
+        return info;
+    }
+
+    // The curve passes through the control points at the start of each segment
+    info.curve = true;
+    info.period = curvePeriod[source];
+    info.align = curveAlign[source] != 0;
+    for (int s = 0; s < curveSegmentCount[source]; s++) {
+        const float* d = &coefficients[(curveFirstSegment[source] + s) * SEGMENT_FLOATS + 9];
+        info.points.push_back(Vertex(d[0], d[1], d[2]));
+    }
+    return info;
+}
+
+void SceneAnimations::evaluate(double seconds) {
+    evaluateCurves(seconds);
+
+    for (size_t c = 0; c < curveStep.size(); c++) {
+        Mat4& out = matrices[curveStep[c]];
+        if (curveAlign[c]) {
+            alignedMatrix((int) c, out);
+        } else {
+            out = Mat4::translation(positions[c * 3], positions[c * 3 + 1], positions[c * 3 + 2]);
+        }
+    }
+
+    for (size_t r = 0; r < rotationStep.size(); r++) {
+        const float* axis = &rotationAxis[r * 3];
+        float angle = 360.0f * lapFraction(seconds, rotationPeriod[r]);
+        matrices[rotationStep[r]] = Mat4::rotation(angle, axis[0], axis[1], axis[2]);
+    }
+}
+
+// Position and direction of every curve. The table lookups are scalar, the
+// polynomials are evaluated for four curves at once.
+void SceneAnimations::evaluateCurves(double seconds) {
+    size_t count = curveStep.size();
+    for (size_t first = 0; first < count; first += 4) {
+        size_t lanes = min(count - first, (size_t) 4);
+        float u[4];
+        const float* coef[4];
+
+        for (size_t lane = 0; lane < 4; lane++) {
+            // Missing lanes repeat the last curve, their results are dropped
+            size_t c = first + min(lane, lanes - 1);
+            const float* table = &arcTable[c * (ARC_TABLE_SIZE + 1)];
+            float s = lapFraction(seconds, curvePeriod[c]) * ARC_TABLE_SIZE;
+            int k = min((int) s, ARC_TABLE_SIZE - 1);
+            float parameter = table[k] + (table[k + 1] - table[k]) * (s - k);
+
+            int segment = min((int) parameter, curveSegmentCount[c] - 1);
+            u[lane] = parameter - segment;
+            coef[lane] = &coefficients[(curveFirstSegment[c] + segment) * SEGMENT_FLOATS];
+        }
+
+#ifdef __SSE__
+        __m128 vu = _mm_loadu_ps(u);
+        for (int axis = 0; axis < 3; axis++) {
+            __m128 a = _mm_setr_ps(coef[0][axis], coef[1][axis], coef[2][axis], coef[3][axis]);
+            __m128 b = _mm_setr_ps(coef[0][3 + axis], coef[1][3 + axis], coef[2][3 + axis], coef[3][3 + axis]);
+            __m128 c = _mm_setr_ps(coef[0][6 + axis], coef[1][6 + axis], coef[2][6 + axis], coef[3][6 + axis]);
+            __m128 d = _mm_setr_ps(coef[0][9 + axis], coef[1][9 + axis], coef[2][9 + axis], coef[3][9 + axis]);
+
+            __m128 point = _mm_add_ps(_mm_mul_ps(a, vu), b);
+            point = _mm_add_ps(_mm_mul_ps(point, vu), c);
+            point = _mm_add_ps(_mm_mul_ps(point, vu), d);
+
+            __m128 tangent = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(a, _mm_set1_ps(3.0f)), vu),
+                                        _mm_mul_ps(b, _mm_set1_ps(2.0f)));
+            tangent = _mm_add_ps(_mm_mul_ps(tangent, vu), c);
+
+            float pointOut[4], tangentOut[4];
+            _mm_storeu_ps(pointOut, point);
+            _mm_storeu_ps(tangentOut, tangent);
+            for (size_t lane = 0; lane < lanes; lane++) {
+                positions[(first + lane) * 3 + axis] = pointOut[lane];
+                tangents[(first + lane) * 3 + axis] = tangentOut[lane];
+            }
+        }
+#else
+        for (size_t lane = 0; lane < lanes; lane++) {
+            curvePoint(coef[lane], u[lane], &positions[(first + lane) * 3]);
+            curveTangent(coef[lane], u[lane], &tangents[(first + lane) * 3]);
+        }
+#endif
+    }
+}
+
+// Translation to the curve position with the X axis along the direction and Y kept
+// as close as possible to the world up axis
+void SceneAnimations::alignedMatrix(int curve, Mat4& out) const {
+    const float* p = &positions[curve * 3];
+    const float* d = &tangents[curve * 3];
+
+    out = Mat4::translation(p[0], p[1], p[2]);
+    float len = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+    if (len == 0.0f) return;
+    float x[3] = {d[0] / len, d[1] / len, d[2] / len};
+
+    // Z = X x up, falling back to the Z axis when moving vertically
+    float z[3] = {-x[2], 0.0f, x[0]};
+    len = sqrtf(z[0] * z[0] + z[2] * z[2]);
+    if (len < 1e-6f) {
+        z[0] = 0.0f; z[2] = 1.0f;
+    } else {
+        z[0] /= len; z[2] /= len;
+    }
+
+    // Y = Z x X
+    float y[3] = {z[1] * x[2] - z[2] * x[1], z[2] * x[0] - z[0] * x[2], z[0] * x[1] - z[1] * x[0]};
+
+    for (int row = 0; row < 3; row++) {
+        out.at(row, 0) = x[row];
+        out.at(row, 1) = y[row];
+        out.at(row, 2) = z[row];
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <vector>
+#include "matrix.h"
+#include "model.h"
+
+// Animated translate and rotate steps of the scene transforms. Curves are closed
+// Catmull-Rom splines; their segment coefficients and arc-length tables are built
+// at load time, so objects move along them at constant speed. evaluate() computes
+// the matrices of all steps for a point in time, the curves four at a time with SSE.
+class SceneAnimations {
+public:
+    // Parameters of a step, enough to add it again
+    struct StepInfo {
+        bool curve;
+        float period;
+        bool align;                 // Curves
+        std::vector<Vertex> points; // Curves
+        float axis[3];              // Rotations
+    };
+
+    static const int SEGMENT_SAMPLES = 16; // Samples per segment when measuring the curve length
+    static const int ARC_TABLE_SIZE = 64;  // Arc-length table intervals per curve
+
+    // Translation along the curve through the points (at least 4), one lap every
+    // period seconds. With align the X axis follows the curve direction.
+    // Returns the step index, or -1 if the curve is invalid.
+    int addCurve(const std::vector<Vertex>& points, float period, bool align);
+
+    // Full turn around the axis every period seconds
+    int addRotation(float period, float x, float y, float z);
+
+    size_t size() const { return matrices.size(); }
+
+    // Compute the matrix of every step at the given time
+    void evaluate(double seconds);
+
+    const Mat4& matrix(int step) const { return matrices[step]; }
+
+    StepInfo stepInfo(int step) const;
+
+private:
+    void evaluateCurves(double seconds);
+    void alignedMatrix(int curve, Mat4& out) const;
+
+    // Curves
+    std::vector<int> curveStep;
+    std::vector<float> curvePeriod;
+    std::vector<unsigned char> curveAlign;
+    std::vector<int> curveFirstSegment;
+    std::vector<int> curveSegmentCount;
+    std::vector<float> arcTable;     // ARC_TABLE_SIZE + 1 curve parameters per curve, at equal lengths
+    std::vector<float> coefficients; // Per segment a, b, c, d (x, y, z each) of a*u^3 + b*u^2 + c*u + d
+
+    // Curve positions and directions of the last evaluation, x, y, z per curve
+    std::vector<float> positions;
+    std::vector<float> tangents;
+
+    // Rotations
+    std::vector<int> rotationStep;
+    std::vector<float> rotationPeriod;
+    std::vector<float> rotationAxis; // x, y, z per rotation
+
+    std::vector<int> stepSource; // Curve index, or -1 - rotation index
+    std::vector<Mat4> matrices;
+};
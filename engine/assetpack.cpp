@@ -0,0 +1,182 @@
+#include "assetpack.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+const char* const AssetPack::SCENE_ENTRY = "scene.scn";
+
+namespace {
+
+const char MAGIC[4] = {'W', 'P', 'A', 'K'};
+
+struct PackHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t entryCount;
+    uint64_t tocOffset;   // DATA_ALIGN aligned
+    uint64_t namesOffset;
+    uint64_t namesSize;
+};
+
+uint64_t alignUp(uint64_t offset) {
+    return (offset + AssetPack::DATA_ALIGN - 1) / AssetPack::DATA_ALIGN * AssetPack::DATA_ALIGN;
+}
+
+} // namespace
+
+AssetPack::AssetPack() : base(nullptr), mappedSize(0), toc(nullptr), count(0), names(nullptr), namesSize(0) {}
+
+AssetPack::~AssetPack() {
+    close();
+}
+
+bool AssetPack::isPackFile(const string& filename) {
+    return filename.size() > 5 && filename.compare(filename.size() - 5, 5, ".pack") == 0;
+}
+
+bool AssetPack::open(const string& filename) {
+    close();
+    auto start = chrono::steady_clock::now();
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        cerr << "Error opening asset pack: " << filename << endl;
+        if (fd >= 0) ::close(fd);
+        return false;
+    }
+
+    size_t size = (size_t) info.st_size;
+    void* mapping = size >= sizeof(PackHeader) ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        cerr << "Not an asset pack: " << filename << endl;
+        return false;
+    }
+
+    // Everything in the pack is needed at startup: start reading all of it now, in
+    // large requests, instead of page by page as the entries are touched
+    madvise(mapping, size, MADV_WILLNEED);
+
+    PackHeader header;
+    memcpy(&header, mapping, sizeof(header));
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION) {
+        cerr << "Not an asset pack (or unsupported version): " << filename << endl;
+        munmap(mapping, size);
+        return false;
+    }
+
+    // Check the table and every entry against the file size, so lookups cannot read outside it
+    bool valid = header.tocOffset % DATA_ALIGN == 0 && header.tocOffset <= size &&
+                 header.entryCount <= (size - header.tocOffset) / sizeof(TocEntry) &&
+                 header.namesOffset <= size && header.namesSize <= size - header.namesOffset;
+    const TocEntry* entries = (const TocEntry*) ((const char*) mapping + header.tocOffset);
+    for (uint64_t i = 0; valid && i < header.entryCount; i++) {
+        const TocEntry& entry = entries[i];
+        valid = entry.offset % DATA_ALIGN == 0 && entry.offset <= size && entry.size <= size - entry.offset &&
+                entry.nameOffset <= header.namesSize && entry.nameLength <= header.namesSize - entry.nameOffset;
+    }
+    if (!valid) {
+        cerr << "Asset pack is damaged: " << filename << endl;
+        munmap(mapping, size);
+        return false;
+    }
+
+    base = (const char*) mapping;
+    mappedSize = size;
+    toc = entries;
+    count = (size_t) header.entryCount;
+    names = base + header.namesOffset;
+    namesSize = (size_t) header.namesSize;
+
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    cout << "Asset pack opened: " << count << " entries, " << size / 1024 << " KB in " << ms << " ms" << endl;
+    return true;
+}
+
+void AssetPack::close() {
+    if (base) munmap((void*) base, mappedSize);
+    base = nullptr;
+    mappedSize = 0;
+    toc = nullptr;
+    count = 0;
+    names = nullptr;
+    namesSize = 0;
+}
+
+bool AssetPack::find(const string& name, const char*& data, size_t& size) const {
+    // Binary search of the sorted table
+    size_t low = 0, high = count;
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        const TocEntry& entry = toc[middle];
+        int order = name.compare(0, string::npos, names + entry.nameOffset, entry.nameLength);
+        if (order == 0) {
+            data = base + entry.offset;
+            size = (size_t) entry.size;
+            return true;
+        }
+        if (order < 0) {
+            high = middle;
+        } else {
+            low = middle + 1;
+        }
+    }
+    return false;
+}
+
+bool AssetPack::write(const string& filename, vector<Entry>& entries) {
+    sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.name < b.name; });
+
+    PackHeader header = {};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.entryCount = entries.size();
+    header.tocOffset = alignUp(sizeof(PackHeader));
+    header.namesOffset = header.tocOffset + entries.size() * sizeof(TocEntry);
+
+    // Names first, then the data placed after them
+    vector<TocEntry> table(entries.size());
+    string nameChars;
+    for (size_t i = 0; i < entries.size(); i++) {
+        table[i].nameOffset = (uint32_t) nameChars.size();
+        table[i].nameLength = (uint32_t) entries[i].name.size();
+        nameChars += entries[i].name;
+    }
+    header.namesSize = nameChars.size();
+
+    uint64_t offset = header.namesOffset + header.namesSize;
+    for (size_t i = 0; i < entries.size(); i++) {
+        offset = alignUp(offset);
+        table[i].offset = offset;
+        table[i].size = entries[i].data.size();
+        offset += entries[i].data.size();
+    }
+
+    ofstream file(filename, ios::binary);
+    static const char zeros[DATA_ALIGN] = {0};
+    file.write((const char*) &header, sizeof(header));
+    file.write(zeros, header.tocOffset - sizeof(header));
+    file.write((const char*) table.data(), table.size() * sizeof(TocEntry));
+    file.write(nameChars.data(), nameChars.size());
+
+    uint64_t written = header.namesOffset + header.namesSize;
+    for (size_t i = 0; i < entries.size(); i++) {
+        file.write(zeros, table[i].offset - written);
+        file.write(entries[i].data.data(), entries[i].data.size());
+        written = table[i].offset + table[i].size;
+    }
+    if (!file) {
+        cerr << "Error writing asset pack: " << filename << endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Single-file bundle of a compiled scene and the model files it uses (packer world.xml
+// world.pack). A header, a table of contents sorted by name and the entry data, each
+// entry starting on a DATA_ALIGN boundary. The engine maps the whole pack once and asks
+// the kernel to read it ahead, so startup costs one open instead of one per model.
+class AssetPack {
+public:
+    static const unsigned int VERSION = 1;
+    static const size_t DATA_ALIGN = 64;
+    static const char* const SCENE_ENTRY; // Name of the compiled scene entry
+
+    // Entry to write
+    struct Entry {
+        std::string name;
+        std::vector<char> data;
+    };
+
+    AssetPack();
+    ~AssetPack();
+    AssetPack(const AssetPack&) = delete;
+    AssetPack& operator=(const AssetPack&) = delete;
+
+    bool open(const std::string& filename);
+    void close();
+    bool isOpen() const { return base != nullptr; }
+
+    // Data of the named entry, valid until the pack is closed
+    bool find(const std::string& name, const char*& data, size_t& size) const;
+
+    size_t entryCount() const { return count; }
+    size_t fileSize() const { return mappedSize; }
+
+    static bool write(const std::string& filename, std::vector<Entry>& entries);
+
+    static bool isPackFile(const std::string& filename);
+
+private:
+    // Table of contents entry as stored
+    struct TocEntry {
+        uint32_t nameOffset; // Into the name characters
+        uint32_t nameLength;
+        uint64_t offset;     // Entry data, from the start of the pack
+        uint64_t size;
+        uint64_t reserved;
+    };
+
+    const char* base;
+    size_t mappedSize;
+    const TocEntry* toc;
+    size_t count;
+    const char* names;
+    size_t namesSize;
+};
@@ -0,0 +1,203 @@
+#define _USE_MATH_DEFINES
+#include "benchmark.h"
+#include <GL/glx.h>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <math.h>
+
+using namespace std;
+
+bool BenchmarkConfig::parseOption(const string& option) {
+    size_t eq = option.find('=');
+    if (eq == string::npos) return false;
+
+    string key = option.substr(0, eq);
+    string value = option.substr(eq + 1);
+
+    if (key == "frames") {
+        frames = atoi(value.c_str());
+        return frames > 0;
+    } else if (key == "warmup") {
+        warmupFrames = atoi(value.c_str());
+        return warmupFrames >= 0;
+    } else if (key == "orbit") {
+        char* end;
+        orbitDegrees = strtof(value.c_str(), &end);
+        return end != value.c_str() && *end == '\0' && isfinite(orbitDegrees);
+    } else if (key == "csv") {
+        csvFile = value;
+        return !csvFile.empty();
+    } else if (key == "path") {
+        pathFile = value;
+        return !pathFile.empty();
+    } else if (key == "realtime") {
+        realtime = value != "0";
+        return true;
+    }
+    return false;
+}
+
+Benchmark::Benchmark()
+    : camera(nullptr), running(false), startAlpha(0), startBeta(0), startRadius(0), pathKey(0), frameIndex(0) {}
+
+bool Benchmark::begin(const BenchmarkConfig& cfg, Camera* cam) {
+    config = cfg;
+    camera = cam;
+
+    path.clear();
+    if (!config.pathFile.empty()) {
+        if (!path.load(config.pathFile)) return false;
+        if (!config.realtime) config.frames = (int) path.size();
+    }
+    running = true;
+
+    startAlpha = camera->getAlpha();
+    startBeta = camera->getBeta();
+    startRadius = camera->getRadius();
+
+    frameIndex = 0;
+    frameTimes.clear();
+    frameTimes.reserve(config.frames);
+    frameViews.clear();
+    frameViews.reserve(config.frames);
+    lastFrameEnd = Clock::now();
+    playbackStart = lastFrameEnd;
+    return true;
+}
+
+// The orbit only depends on the frame number, so every run sees the same views
+float Benchmark::orbitAlpha(int frame) const {
+    return startAlpha + frame * config.orbitDegrees * (float) M_PI / 180.0f;
+}
+
+// Seconds of real-time playback, counted from the first measured frame
+double Benchmark::playbackSeconds() const {
+    if (frameIndex < config.warmupFrames) return 0.0;
+    return chrono::duration<double>(Clock::now() - playbackStart).count();
+}
+
+void Benchmark::applyView(int frame, double aheadSeconds) {
+    if (path.size() == 0) {
+        camera->setSpherical(orbitAlpha(frame), startBeta, startRadius);
+        return;
+    }
+
+    // Warm-up frames show the first key
+    size_t key;
+    if (config.realtime) {
+        key = path.keyAt((float) (playbackSeconds() + aheadSeconds));
+    } else {
+        key = (size_t) min(max(frame - config.warmupFrames, 0), (int) path.size() - 1);
+    }
+    path.apply(key, *camera);
+    if (frame == frameIndex) pathKey = key;
+}
+
+void Benchmark::prepareFrame() {
+    if (!running) return;
+    applyView(frameIndex, 0.0);
+}
+
+void Benchmark::prepareNextFrame() {
+    if (!running) return;
+
+    // Real-time playback guesses the next frame's time from the last frame time
+    double lastFrameSeconds = frameTimes.empty() ? 0.0 : frameTimes.back() / 1000.0;
+    applyView(frameIndex + 1, lastFrameSeconds);
+}
+
+bool Benchmark::endFrame() {
+    if (!running) return false;
+
+    Clock::time_point now = Clock::now();
+    double ms = chrono::duration<double, milli>(now - lastFrameEnd).count();
+    lastFrameEnd = now;
+
+    if (frameIndex >= config.warmupFrames) {
+        frameTimes.push_back(ms);
+        frameViews.push_back(path.size() > 0 ? path.key(pathKey).time : orbitAlpha(frameIndex));
+    }
+    frameIndex++;
+    if (frameIndex == config.warmupFrames) {
+        playbackStart = now;
+    }
+
+    // Real-time playback ends with the recording, a fixed-step one after the last key
+    bool done = config.realtime && path.size() > 0 ? playbackSeconds() > path.duration()
+                                                    : (int) frameTimes.size() >= config.frames;
+    if (done) {
+        running = false;
+    }
+    return running;
+}
+
+double Benchmark::averageFrameMs() const {
+    if (frameTimes.empty()) return 0.0;
+
+    double total = 0.0;
+    for (double t : frameTimes) total += t;
+    return total / frameTimes.size();
+}
+
+double Benchmark::percentileMs(double p) const {
+    if (frameTimes.empty()) return 0.0;
+
+    vector<double> sorted(frameTimes);
+    size_t k = (size_t) (p / 100.0 * (sorted.size() - 1) + 0.5);
+    nth_element(sorted.begin(), sorted.begin() + k, sorted.end());
+    return sorted[k];
+}
+
+void Benchmark::report() const {
+    if (frameTimes.empty()) return;
+
+    double average = averageFrameMs();
+
+    cout << "\n--- Benchmark results (" << frameTimes.size() << " frames) ---" << endl;
+    cout << "Average: " << average << " ms (" << 1000.0 / average << " FPS)" << endl;
+    cout << "p50: " << percentileMs(50) << " ms" << endl;
+    cout << "p95: " << percentileMs(95) << " ms" << endl;
+    cout << "p99: " << percentileMs(99) << " ms" << endl;
+
+    ofstream csv(config.csvFile);
+    if (!csv.is_open()) {
+        cerr << "Error writing benchmark CSV: " << config.csvFile << endl;
+        return;
+    }
+
+    csv << (path.size() > 0 ? "frame,path_time,frame_ms\n" : "frame,alpha,frame_ms\n");
+    for (size_t i = 0; i < frameTimes.size(); i++) {
+        csv << i << "," << frameViews[i] << "," << frameTimes[i] << "\n";
+    }
+    cout << "Frame times written to " << config.csvFile << endl;
+}
+
+// Driver-specific environment switches, must be set before the context is created
+void Benchmark::disableVsyncEnv() {
+    setenv("vblank_mode", "0", 1);          // Mesa
+    setenv("__GL_SYNC_TO_VBLANK", "0", 1);  // NVIDIA
+}
+
+// Set the swap interval to 0 through whichever GLX extension is available
+void Benchmark::disableVsync() {
+    typedef int (*SwapIntervalMESA)(unsigned int);
+    typedef void (*SwapIntervalEXT)(Display*, GLXDrawable, int);
+
+    Display* display = glXGetCurrentDisplay();
+    GLXDrawable drawable = glXGetCurrentDrawable();
+    if (!display || !drawable) return;
+
+    string extensions = glXQueryExtensionsString(display, DefaultScreen(display));
+
+    if (extensions.find("GLX_EXT_swap_control") != string::npos) {
+        SwapIntervalEXT swapExt = (SwapIntervalEXT) glXGetProcAddressARB((const GLubyte*) "glXSwapIntervalEXT");
+        swapExt(display, drawable, 0);
+    } else if (extensions.find("GLX_MESA_swap_control") != string::npos) {
+        SwapIntervalMESA swapMesa = (SwapIntervalMESA) glXGetProcAddressARB((const GLubyte*) "glXSwapIntervalMESA");
+        swapMesa(0);
+    } else {
+        cerr << "Could not disable vsync, frame times may be capped by the display" << endl;
+    }
+}
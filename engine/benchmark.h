@@ -0,0 +1,77 @@
+#pragma once
+#include <chrono>
+#include <string>
+#include <vector>
+#include "camera.h"
+#include "camerapath.h"
+
+// Settings given on the command line: --bench frames=N orbit=DEG warmup=N csv=FILE path=FILE realtime=1
+struct BenchmarkConfig {
+    bool enabled;
+    int frames;          // Number of measured frames
+    int warmupFrames;    // Frames rendered before measuring starts
+    float orbitDegrees;  // Camera rotation around the lookAt point per frame
+    std::string csvFile;
+
+    std::string pathFile; // Replay a recorded camera path instead of orbiting (--play)
+    bool realtime;        // Replay the path at its recorded speed instead of one key per frame
+
+    BenchmarkConfig() : enabled(false), frames(1000), warmupFrames(10), orbitDegrees(1.0f),
+                        csvFile("bench.csv"), realtime(false) {}
+
+    // Parse a single key=value option, returns false if it is not recognised
+    bool parseOption(const std::string& option);
+};
+
+class Benchmark {
+public:
+    Benchmark();
+
+    // Start the run from the current camera position, or load the camera path to replay.
+    // A fixed-step replay renders one frame per recorded key.
+    bool begin(const BenchmarkConfig& config, Camera* camera);
+    bool isRunning() const { return running; }
+
+    // Frames rendered including warm-up (an estimate for real-time playback)
+    int frameCount() const { return config.warmupFrames + (config.realtime ? (int) path.size() : config.frames); }
+
+    // Move the camera to the orbit position or path key of the next frame
+    void prepareFrame();
+
+    // Move the camera one frame further, so that frame can be prepared while the current one is drawn
+    void prepareNextFrame();
+
+    // Record the end of a frame (after the buffer swap), returns false when the run is over
+    bool endFrame();
+
+    // Frame-time statistics of the measured frames
+    double averageFrameMs() const;
+    double percentileMs(double p) const;
+
+    // Print the frame-time summary and write the CSV file
+    void report() const;
+
+    // Request an unsynchronised swap interval (before and after context creation)
+    static void disableVsyncEnv();
+    static void disableVsync();
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    float orbitAlpha(int frame) const;
+    double playbackSeconds() const;
+    void applyView(int frame, double aheadSeconds);
+
+    BenchmarkConfig config;
+    Camera* camera;
+    bool running;
+
+    float startAlpha, startBeta, startRadius;
+    CameraPath path;
+    size_t pathKey; // Key applied by the last prepareFrame
+    Clock::time_point playbackStart;
+    int frameIndex; // Includes warm-up frames
+    Clock::time_point lastFrameEnd;
+    std::vector<double> frameTimes;
+    std::vector<float> frameViews; // Orbit angle, or path time of the key shown
+};
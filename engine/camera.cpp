@@ -1,7 +1,6 @@
 #define _USE_MATH_DEFINES
 #include "camera.h"
 #include <math.h>
-#include <GL/glut.h>
 #include <iostream>
 
 // Default constructor
@@ -61,6 +60,7 @@ void Camera::spherical2Cartesian() {
     posX = lookAtX + radius * sin(alpha) * cos(beta);
     posY = lookAtY + radius * sin(beta);
     posZ = lookAtZ + radius * cos(alpha) * cos(beta);
+    invalidateView();
 }
 
 // Set camera position
@@ -69,6 +69,7 @@ void Camera::setPosition(float x, float y, float z) {
     posY = y;
     posZ = z;
     calculateSphericalCoords();
+    invalidateView();
 }
 
 // Set lookAt point
@@ -77,6 +78,7 @@ void Camera::setLookAt(float x, float y, float z) {
     lookAtY = y;
     lookAtZ = z;
     calculateSphericalCoords();
+    invalidateView();
 }
 
 // Set up vector
@@ -84,6 +86,7 @@ void Camera::setUp(float x, float y, float z) {
     upX = x;
     upY = y;
     upZ = z;
+    invalidateView();
 }
 
 // Set projection parameters
@@ -91,54 +94,95 @@ void Camera::setProjection(float fovVal, float near, float far) {
     fov = fovVal;
     nearPlane = near;
     farPlane = far;
+    invalidateProjection();
+}
+
+// Set the aspect ratio of the viewport
+void Camera::setAspect(float aspectVal) {
+    if (aspectVal == aspect) return;
+    aspect = aspectVal;
+    invalidateProjection();
+}
+
+// Set spherical coordinates and update the camera position
+void Camera::setSpherical(float alphaVal, float betaVal, float radiusVal) {
+    alpha = alphaVal;
+    beta = betaVal;
+    radius = radiusVal;
+    
+    if (beta >= M_PI / 2) beta = M_PI / 2 - 0.01f; // Prevent camera flip
+    if (beta <= -M_PI / 2) beta = -M_PI / 2 + 0.01f;
+    if (radius < 0.1f) radius = 0.1f;
+    spherical2Cartesian();
 }
 
 // Rotate camera to the left
-void Camera::rotateLeft() {
-    alpha -= 0.1f;
+void Camera::rotateLeft(float angle) {
+    alpha -= angle;
     spherical2Cartesian();
 }
 
 // Rotate camera to the right
-void Camera::rotateRight() {
-    alpha += 0.1f;
+void Camera::rotateRight(float angle) {
+    alpha += angle;
     spherical2Cartesian();
 }
 
 // Rotate camera up
-void Camera::rotateUp() {
-    beta += 0.1f;
+void Camera::rotateUp(float angle) {
+    beta += angle;
     if (beta >= M_PI / 2) beta = M_PI / 2 - 0.01f; // Prevent camera flip
     spherical2Cartesian();
 }
 
 // Rotate camera down
-void Camera::rotateDown() {
-    beta -= 0.1f;
+void Camera::rotateDown(float angle) {
+    beta -= angle;
     if (beta <= -M_PI / 2) beta = -M_PI / 2 + 0.01f; // Prevent camera flip
     spherical2Cartesian();
 }
 
 // Zoom in (decrease radius)
-void Camera::zoomIn() {
-    radius -= 0.1f;
+void Camera::zoomIn(float amount) {
+    radius -= amount;
     if (radius < 0.1f) radius = 0.1f; // Prevent negative or zero radius
     spherical2Cartesian();
 }
 
 // Zoom out (increase radius)
-void Camera::zoomOut() {
-    radius += 0.1f;
+void Camera::zoomOut(float amount) {
+    radius += amount;
     spherical2Cartesian();
 }
 
-// Place the camera in the scene (to be called in the rendering loop)
-void Camera::place() {
-    gluLookAt(posX, posY, posZ,
-              lookAtX, lookAtY, lookAtZ,
-              upX, upY, upZ);
+// View matrix of the camera
+const Mat4& Camera::getViewMatrix() const {
+    if (viewDirty) {
+        view = Mat4::lookAt(posX, posY, posZ, lookAtX, lookAtY, lookAtZ, upX, upY, upZ);
+        viewDirty = false;
+    }
+    return view;
+}
+
+// Projection matrix for the current aspect ratio
+const Mat4& Camera::getProjectionMatrix() const {
+    if (projectionDirty) {
+        projection = Mat4::perspective(fov, aspect, nearPlane, farPlane);
+        projectionDirty = false;
+    }
+    return projection;
 }
 
+// Projection * view
+const Mat4& Camera::getViewProjectionMatrix() const {
+    if (viewProjectionDirty) {
+        viewProjection = getProjectionMatrix() * getViewMatrix();
+        viewProjectionDirty = false;
+    }
+    return viewProjection;
+}
+
+
 
 
 
@@ -1,6 +1,7 @@
 #pragma once
 #define _USE_MATH_DEFINES
 #include <math.h>
+#include "matrix.h"
 
 class Camera {
 private:
@@ -18,6 +19,18 @@ private:
     
     // Spherical coordinates
     float alpha, beta, radius;
+    
+    // Viewport width / height
+    float aspect = 1.0f;
+    
+    // Matrices computed on demand and kept until the parameters they depend on change
+    mutable Mat4 view, projection, viewProjection;
+    mutable bool viewDirty = true;
+    mutable bool projectionDirty = true;
+    mutable bool viewProjectionDirty = true;
+    
+    void invalidateView() { viewDirty = true; viewProjectionDirty = true; }
+    void invalidateProjection() { projectionDirty = true; viewProjectionDirty = true; }
 
 public:
     // Constructor
@@ -45,12 +58,21 @@ public:
     float getFov() const { return fov; }
     float getNearPlane() const { return nearPlane; }
     float getFarPlane() const { return farPlane; }
+    float getAspect() const { return aspect; }
+    
+    float getAlpha() const { return alpha; }
+    float getBeta() const { return beta; }
+    float getRadius() const { return radius; }
     
     // Setters
     void setPosition(float x, float y, float z);
     void setLookAt(float x, float y, float z);
     void setUp(float x, float y, float z);
     void setProjection(float fov, float near, float far);
+    void setAspect(float aspect);
+    
+    // Set the position from spherical coordinates around the lookAt point
+    void setSpherical(float alpha, float beta, float radius);
     
     // Calculate spherical coordinates from camera position
     void calculateSphericalCoords();
@@ -58,14 +80,17 @@ public:
     // Update camera position based on spherical coordinates
     void spherical2Cartesian();
     
-    // Movement methods
-    void rotateLeft();
-    void rotateRight();
-    void rotateUp();
-    void rotateDown();
-    void zoomIn();
-    void zoomOut();
+    // Movement methods (angles in radians, zoom in scene units)
+    void rotateLeft(float angle = 0.1f);
+    void rotateRight(float angle = 0.1f);
+    void rotateUp(float angle = 0.1f);
+    void rotateDown(float angle = 0.1f);
+    void zoomIn(float amount = 0.1f);
+    void zoomOut(float amount = 0.1f);
     
-    // Place the camera (to be called in the rendering loop)
-    void place();
+    // Cached matrices equivalent to gluLookAt, gluPerspective and their product, for
+    // the GL paths, culling and the software renderer. Not thread-safe: threads use their own copies.
+    const Mat4& getViewMatrix() const;
+    const Mat4& getProjectionMatrix() const;
+    const Mat4& getViewProjectionMatrix() const;
 };
\ No newline at end of file
@@ -0,0 +1,98 @@
+#include "camerapath.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+using namespace std;
+
+static const char MAGIC[4] = {'C', 'P', 'T', 'H'};
+
+void CameraPath::add(float time, const Camera& camera) {
+    CameraKey key;
+    key.time = time;
+    key.position[0] = camera.getPosX();
+    key.position[1] = camera.getPosY();
+    key.position[2] = camera.getPosZ();
+    key.lookAt[0] = camera.getLookAtX();
+    key.lookAt[1] = camera.getLookAtY();
+    key.lookAt[2] = camera.getLookAtZ();
+    key.up[0] = camera.getUpX();
+    key.up[1] = camera.getUpY();
+    key.up[2] = camera.getUpZ();
+    key.fov = camera.getFov();
+
+    // Only changes are stored, playback holds a state until the next key
+    if (!keys.empty()) {
+        const CameraKey& last = keys.back();
+        if (memcmp(last.position, key.position, sizeof(float) * 10) == 0) return;
+    }
+    keys.push_back(key);
+}
+
+bool CameraPath::save(const string& filename) const {
+    ofstream file(filename, ios::binary);
+    if (!file) {
+        cerr << "Error writing camera path: " << filename << endl;
+        return false;
+    }
+
+    uint32_t header[2] = {VERSION, (uint32_t) keys.size()};
+    file.write(MAGIC, sizeof(MAGIC));
+    file.write((const char*) header, sizeof(header));
+    file.write((const char*) keys.data(), keys.size() * sizeof(CameraKey));
+    return (bool) file;
+}
+
+bool CameraPath::load(const string& filename) {
+    ifstream file(filename, ios::binary);
+    if (!file) {
+        cerr << "Error opening camera path: " << filename << endl;
+        return false;
+    }
+
+    char magic[4];
+    uint32_t header[2];
+    file.read(magic, sizeof(magic));
+    file.read((char*) header, sizeof(header));
+    if (!file || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || header[0] != VERSION) {
+        cerr << "Not a camera path file (or unsupported version): " << filename << endl;
+        return false;
+    }
+
+    // The key count must match the rest of the file before anything is allocated for it
+    streamoff keysStart = file.tellg();
+    file.seekg(0, ios::end);
+    streamoff keyBytes = file.tellg() - keysStart;
+    file.seekg(keysStart);
+    if (!file || keyBytes != (streamoff) header[1] * (streamoff) sizeof(CameraKey)) {
+        cerr << "Camera path is damaged (" << header[1] << " keys do not match the file size): " << filename << endl;
+        return false;
+    }
+
+    keys.resize(header[1]);
+    file.read((char*) keys.data(), keys.size() * sizeof(CameraKey));
+    if (!file || keys.empty()) {
+        cerr << "Camera path is truncated or empty: " << filename << endl;
+        keys.clear();
+        return false;
+    }
+    return true;
+}
+
+size_t CameraPath::keyAt(float time) const {
+    auto after = upper_bound(keys.begin(), keys.end(), time,
+                             [](float t, const CameraKey& key) { return t < key.time; });
+    return after == keys.begin() ? 0 : (size_t) (after - keys.begin()) - 1;
+}
+
+void CameraPath::apply(size_t index, Camera& camera) const {
+    const CameraKey& key = keys[index];
+    camera.setPosition(key.position[0], key.position[1], key.position[2]);
+    camera.setLookAt(key.lookAt[0], key.lookAt[1], key.lookAt[2]);
+    camera.setUp(key.up[0], key.up[1], key.up[2]);
+    if (key.fov != camera.getFov()) {
+        camera.setProjection(key.fov, camera.getNearPlane(), camera.getFarPlane());
+    }
+}
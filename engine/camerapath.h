@@ -0,0 +1,42 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "camera.h"
+
+// Camera state at a point in time
+struct CameraKey {
+    float time; // Seconds since the recording started
+    float position[3];
+    float lookAt[3];
+    float up[3];
+    float fov;
+};
+
+// Sequence of camera states recorded from a session, stored as a small binary file:
+// "CPTH", version and key count (uint32 each), then the keys as packed floats
+// in host byte order
+class CameraPath {
+public:
+    static const unsigned int VERSION = 1;
+
+    void clear() { keys.clear(); }
+
+    // Append the camera state, unless it equals the last key
+    void add(float time, const Camera& camera);
+
+    bool save(const std::string& filename) const;
+    bool load(const std::string& filename);
+
+    size_t size() const { return keys.size(); }
+    float duration() const { return keys.empty() ? 0.0f : keys.back().time; }
+    const CameraKey& key(size_t index) const { return keys[index]; }
+
+    // Index of the last key at or before the given time
+    size_t keyAt(float time) const;
+
+    // Move the camera to a recorded state (near and far planes are kept)
+    void apply(size_t index, Camera& camera) const;
+
+private:
+    std::vector<CameraKey> keys;
+};
@@ -0,0 +1,323 @@
+#define GL_GLEXT_PROTOTYPES
+#include "corerenderer.h"
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+static const char* VERTEX_SHADER =
+    "#version 330 core\n"
+    "layout(std140) uniform Camera {\n"
+    "    mat4 view;\n"
+    "    mat4 projection;\n"
+    "    mat4 viewProjection;\n"
+    "};\n"
+    "layout(location = 0) in vec3 position;\n"
+    "layout(location = 1) in vec4 color;\n"
+    "uniform mat4 model;\n"
+    "out vec4 vertexColor;\n"
+    "void main() {\n"
+    "    vertexColor = color;\n"
+    "    gl_Position = viewProjection * (model * vec4(position, 1.0));\n"
+    "}\n";
+
+static const char* FRAGMENT_SHADER =
+    "#version 330 core\n"
+    "in vec4 vertexColor;\n"
+    "out vec4 fragColor;\n"
+    "void main() {\n"
+    "    fragColor = vertexColor;\n"
+    "}\n";
+
+static GLuint compileShader(GLenum type, const char* source) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+
+    GLint compiled = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (!compiled) {
+        char log[1024];
+        glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+        cerr << "Error compiling shader: " << log << endl;
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+CoreRenderer::CoreRenderer()
+    : program(0), vertexArray(0), vertexBuffer(0), cameraBuffer(0), axesFirst(0), bufferUsed(0), bufferCapacity(0),
+      bufferLimit(0), meshVertices(0), modelLocation(-1), cameraUploaded(false), modelUploaded(false) {}
+
+bool CoreRenderer::buildProgram() {
+    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, VERTEX_SHADER);
+    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, FRAGMENT_SHADER);
+    if (!vertexShader || !fragmentShader) return false;
+
+    program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glLinkProgram(program);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        char log[1024];
+        glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+        cerr << "Error linking shader program: " << log << endl;
+        return false;
+    }
+
+    // Binding points in the shader need GLSL 4.20, so the block is bound here
+    GLuint blockIndex = glGetUniformBlockIndex(program, "Camera");
+    if (blockIndex == GL_INVALID_INDEX) {
+        cerr << "Shader program has no Camera uniform block" << endl;
+        return false;
+    }
+    glUniformBlockBinding(program, blockIndex, CAMERA_BINDING);
+
+    modelLocation = glGetUniformLocation(program, "model");
+    return true;
+}
+
+bool CoreRenderer::init(vector<ModelData>& models, GLStateCache& state, FrameProfiler& profiler) {
+    if (!buildProgram()) return false;
+
+    glGenVertexArrays(1, &vertexArray);
+    state.bindVertexArray(vertexArray);
+
+    vector<ModelData*> meshes;
+    for (ModelData& modelData : models) {
+        if (modelData.loaded) meshes.push_back(&modelData);
+    }
+    fillBuffer(meshes, 0, state, profiler);
+
+    glGenBuffers(1, &cameraBuffer);
+    state.bindBuffer(GL_UNIFORM_BUFFER, cameraBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_BINDING, cameraBuffer);
+    return true;
+}
+
+// All meshes and the axis lines go into one new buffer, models keep their first vertex
+void CoreRenderer::fillBuffer(const vector<ModelData*>& meshes, size_t spare, GLStateCache& state,
+                              FrameProfiler& profiler) {
+    vector<DrawVertex> vertices;
+    for (ModelData* modelData : meshes) {
+        modelData->firstVertex = (unsigned int) vertices.size();
+        vertices.insert(vertices.end(), modelData->drawVertices.begin(), modelData->drawVertices.end());
+    }
+
+    meshVertices = vertices.size();
+    freeRanges.clear();
+    axesFirst = (int) vertices.size();
+    const DrawVertex axes[6] = {
+        {-100.0f, 0.0f, 0.0f, 255, 0, 0, 255}, {100.0f, 0.0f, 0.0f, 255, 0, 0, 255},
+        {0.0f, -100.0f, 0.0f, 0, 255, 0, 255}, {0.0f, 100.0f, 0.0f, 0, 255, 0, 255},
+        {0.0f, 0.0f, -100.0f, 0, 0, 255, 255}, {0.0f, 0.0f, 100.0f, 0, 0, 255, 255},
+    };
+    vertices.insert(vertices.end(), axes, axes + 6);
+
+    state.deleteBuffer(vertexBuffer);
+    glGenBuffers(1, &vertexBuffer);
+    state.bindVertexArray(vertexArray);
+    state.bindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    bufferUsed = vertices.size();
+    bufferCapacity = vertices.size() + spare;
+    glBufferData(GL_ARRAY_BUFFER, bufferCapacity * sizeof(DrawVertex), spare ? nullptr : vertices.data(),
+                 GL_STATIC_DRAW);
+    if (spare) glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(DrawVertex), vertices.data());
+    profiler.countUpload((long) (vertices.size() * sizeof(DrawVertex)));
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(DrawVertex), (const void*) offsetof(DrawVertex, x));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(DrawVertex), (const void*) offsetof(DrawVertex, r));
+
+    for (ModelData* modelData : meshes) {
+        modelData->drawBuffer = vertexBuffer;
+    }
+}
+
+// Rebuild the buffer from the meshes still in it (and the added one), which drops the
+// ranges of evicted models. It gets as much room again for the next uploads, within the limit.
+void CoreRenderer::rebuildBuffer(vector<ModelData>& models, ModelData* added, GLStateCache& state,
+                                 FrameProfiler& profiler) {
+    vector<ModelData*> meshes;
+    size_t used = 6;
+    for (ModelData& other : models) {
+        if (other.loaded && other.drawBuffer == vertexBuffer) {
+            meshes.push_back(&other);
+            used += other.drawVertices.size();
+        }
+    }
+    if (added) {
+        meshes.push_back(added);
+        used += added->drawVertices.size();
+    }
+
+    size_t spare = used;
+    if (bufferLimit > 0) {
+        size_t limit = bufferLimit / sizeof(DrawVertex);
+        spare = min(spare, limit > used ? limit - used : 0);
+    }
+    fillBuffer(meshes, spare, state, profiler);
+}
+
+void CoreRenderer::writeModel(ModelData& modelData, size_t first, GLStateCache& state, FrameProfiler& profiler) {
+    size_t bytes = modelData.drawVertices.size() * sizeof(DrawVertex);
+    state.bindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(DrawVertex), bytes, modelData.drawVertices.data());
+    profiler.countUpload((long) bytes);
+    modelData.firstVertex = (unsigned int) first;
+    modelData.drawBuffer = vertexBuffer;
+    meshVertices += modelData.drawVertices.size();
+}
+
+size_t CoreRenderer::uploadModel(vector<ModelData>& models, int model, GLStateCache& state,
+                                 FrameProfiler& profiler) {
+    ModelData& modelData = models[model];
+    size_t count = modelData.drawVertices.size();
+    size_t bytes = count * sizeof(DrawVertex);
+
+    // Reuse the first free range large enough
+    for (size_t i = 0; i < freeRanges.size(); i++) {
+        pair<size_t, size_t>& range = freeRanges[i];
+        if (range.second < count) continue;
+
+        size_t first = range.first;
+        range.first += count;
+        range.second -= count;
+        if (range.second == 0) freeRanges.erase(freeRanges.begin() + i);
+        writeModel(modelData, first, state, profiler);
+        return bytes;
+    }
+
+    // Then append behind the last mesh while there is room
+    if (bufferUsed + count <= bufferCapacity) {
+        writeModel(modelData, bufferUsed, state, profiler);
+        bufferUsed += count;
+        return bytes;
+    }
+
+    rebuildBuffer(models, &modelData, state, profiler);
+    return bufferUsed * sizeof(DrawVertex);
+}
+
+void CoreRenderer::releaseModel(ModelData& modelData) {
+    if (modelData.drawBuffer != vertexBuffer) return;
+
+    size_t first = modelData.firstVertex;
+    size_t count = modelData.drawVertices.size();
+    modelData.drawBuffer = 0;
+    meshVertices -= count;
+
+    // Merge the range with its free neighbours
+    auto next = lower_bound(freeRanges.begin(), freeRanges.end(), make_pair(first, (size_t) 0));
+    if (next != freeRanges.end() && next->first == first + count) {
+        count += next->second;
+        next = freeRanges.erase(next);
+    }
+    if (next != freeRanges.begin() && (next - 1)->first + (next - 1)->second == first) {
+        --next;
+        next->second += count;
+    } else {
+        next = freeRanges.insert(next, make_pair(first, count));
+    }
+
+    // A free range at the end gives the room back to appends
+    if (next->first + next->second == bufferUsed) {
+        bufferUsed = next->first;
+        freeRanges.erase(next);
+    }
+}
+
+bool CoreRenderer::trim(vector<ModelData>& models, GLStateCache& state, FrameProfiler& profiler) {
+    size_t used = meshVertices + 6;
+    bool overLimit = bufferLimit > 0 && bufferCapacity * sizeof(DrawVertex) > bufferLimit;
+    if (bufferCapacity <= used || (bufferCapacity - used <= used && !overLimit)) return false;
+
+    rebuildBuffer(models, nullptr, state, profiler);
+    return true;
+}
+
+size_t CoreRenderer::unusedBytes() const {
+    return (bufferCapacity - meshVertices) * sizeof(DrawVertex);
+}
+
+// Upload the camera block, only when the camera moved
+void CoreRenderer::updateCamera(const RenderList& list, FrameProfiler& profiler) {
+    CameraBlock block;
+    const Camera& camera = list.request.camera;
+    block.view = camera.getViewMatrix();
+    block.projection = camera.getProjectionMatrix();
+    block.viewProjection = camera.getViewProjectionMatrix();
+
+    if (cameraUploaded && memcmp(&block, &uploadedCamera, sizeof(block)) == 0) return;
+
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(block), &block);
+    profiler.countUpload(sizeof(block));
+    uploadedCamera = block;
+    cameraUploaded = true;
+}
+
+// Set the world matrix of the next draws, only when it differs from the last one
+void CoreRenderer::setModelMatrix(const Mat4& world, FrameProfiler& profiler) {
+    if (modelUploaded && memcmp(world.m, uploadedModel.m, sizeof(world.m)) == 0) return;
+
+    glUniformMatrix4fv(modelLocation, 1, GL_FALSE, world.m);
+    profiler.countUpload(sizeof(world.m));
+    uploadedModel = world;
+    modelUploaded = true;
+}
+
+void CoreRenderer::drawFrame(const RenderList& list, bool showAxes, GLStateCache& state, FrameProfiler& profiler) {
+    state.useProgram(program);
+    state.bindVertexArray(vertexArray);
+    state.bindBuffer(GL_UNIFORM_BUFFER, cameraBuffer);
+    updateCamera(list, profiler);
+
+    if (showAxes) {
+        setModelMatrix(Mat4::identity(), profiler);
+        glDrawArrays(GL_LINES, axesFirst, 6);
+        profiler.countDraw(0, 0, 6);
+    }
+
+    // Consecutive draws with the same material and world matrix become one glMultiDrawArrays
+    const vector<DrawItem>& items = list.queue.getItems();
+    const vector<MaterialState>& materials = list.queue.getMaterials();
+    size_t begin = 0;
+    while (begin < items.size()) {
+        SortKey materialBits = items[begin].key & MATERIAL_KEY_MASK;
+        const MaterialState& material = materials[keyMaterial(items[begin].key)];
+        const Mat4* world = items[begin].world;
+
+        firsts.clear();
+        counts.clear();
+        long triangles = 0, vertexCount = 0;
+        size_t end = begin;
+        for (; end < items.size() && (items[end].key & MATERIAL_KEY_MASK) == materialBits &&
+               items[end].world == world; end++) {
+            const ModelData* model = items[end].model;
+            firsts.push_back((int) model->firstVertex);
+            counts.push_back((int) model->drawVertices.size());
+            triangles += model->triangleCount();
+            vertexCount += (long) model->drawVertices.size();
+        }
+
+        setModelMatrix(*world, profiler);
+        state.polygonMode(material.wireframe ? GL_LINE : GL_FILL);
+        state.setEnabled(GL_CULL_FACE, material.cullFace);
+        glMultiDrawArrays(GL_TRIANGLES, firsts.data(), counts.data(), (GLsizei) firsts.size());
+        profiler.countDraw((long) firsts.size(), triangles, vertexCount);
+
+        begin = end;
+    }
+}
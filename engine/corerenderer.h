@@ -0,0 +1,80 @@
+#pragma once
+#include <utility>
+#include <vector>
+#include "glstate.h"
+#include "matrix.h"
+#include "model.h"
+#include "profiler.h"
+#include "renderlist.h"
+
+// OpenGL 3.3 core-profile renderer: one GLSL program, the camera matrices in a
+// uniform buffer and every mesh in a single vertex buffer behind one vertex
+// array object, so a frame is a glMultiDrawArrays per material and world matrix
+class CoreRenderer {
+public:
+    // Binding point of the Camera uniform block
+    static const int CAMERA_BINDING = 0;
+
+    CoreRenderer();
+
+    // Compile the shaders and upload all models into the shared vertex buffer
+    // (sets their drawBuffer and firstVertex). Requires a current 3.3+ context.
+    bool init(std::vector<ModelData>& models, GLStateCache& state, FrameProfiler& profiler);
+
+    // Add a model loaded after init to the shared buffer, in the range of an evicted
+    // model if one is large enough. Returns the bytes uploaded, which include the other
+    // meshes when the buffer had to grow.
+    size_t uploadModel(std::vector<ModelData>& models, int model, GLStateCache& state, FrameProfiler& profiler);
+
+    // Free the range of a model that is evicted, for the next uploads
+    void releaseModel(ModelData& modelData);
+
+    // Size the shared buffer does not grow beyond while the meshes fit (0 = no limit)
+    void setBufferLimit(size_t bytes) { bufferLimit = bytes; }
+
+    // Rebuild the shared buffer from the meshes in it when evictions left most of it
+    // unused, or when it is over the limit. True if it was rebuilt.
+    bool trim(std::vector<ModelData>& models, GLStateCache& state, FrameProfiler& profiler);
+
+    // Memory of the shared buffer not holding a mesh (bytes)
+    size_t unusedBytes() const;
+
+    // Draw a prepared render list, plus the coordinate axes if requested
+    void drawFrame(const RenderList& list, bool showAxes, GLStateCache& state, FrameProfiler& profiler);
+
+private:
+    // Camera uniform block, std140 layout
+    struct CameraBlock {
+        Mat4 view;
+        Mat4 projection;
+        Mat4 viewProjection;
+    };
+
+    bool buildProgram();
+    void fillBuffer(const std::vector<ModelData*>& meshes, size_t spare, GLStateCache& state, FrameProfiler& profiler);
+    void rebuildBuffer(std::vector<ModelData>& models, ModelData* added, GLStateCache& state, FrameProfiler& profiler);
+    void writeModel(ModelData& modelData, size_t first, GLStateCache& state, FrameProfiler& profiler);
+    void updateCamera(const RenderList& list, FrameProfiler& profiler);
+    void setModelMatrix(const Mat4& world, FrameProfiler& profiler);
+
+    unsigned int program;
+    unsigned int vertexArray;
+    unsigned int vertexBuffer;
+    unsigned int cameraBuffer;
+    int axesFirst; // First vertex of the axis lines in the shared buffer
+    size_t bufferUsed;     // Vertices in the shared buffer, models appended after init go behind them
+    size_t bufferCapacity;
+    size_t bufferLimit;    // Bytes, 0 = no limit
+    size_t meshVertices;   // Vertices of the models in the shared buffer
+    std::vector<std::pair<size_t, size_t>> freeRanges; // First vertex and count of evicted ranges, in order
+    int modelLocation;
+
+    CameraBlock uploadedCamera;
+    bool cameraUploaded;
+    Mat4 uploadedModel;
+    bool modelUploaded;
+
+    // Per-draw ranges of the current multi-draw batch
+    std::vector<int> firsts;
+    std::vector<int> counts;
+};
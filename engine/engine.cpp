@@ -1,217 +1,294 @@
 #define _USE_MATH_DEFINES
+#define GL_GLEXT_PROTOTYPES
 #include <iostream>
 #include <fstream>
 #include <vector>
 #include <string>
 #include <math.h>
-#include <GL/glut.h>
-#include "tinyxml2.h"
+#include <chrono>
+#include <GL/freeglut.h>
 #include "camera.h"
 #include "parser.h"
-#include <map>
+#include "model.h"
+#include "profiler.h"
+#include "benchmark.h"
+#include "options.h"
+#include "softrast.h"
+#include "threadpool.h"
+#include "occlusion.h"
+#include "renderlist.h"
+#include "glstate.h"
+#include "corerenderer.h"
+#include "renderstats.h"
+#include "input.h"
+#include "scene.h"
+#include "scenefile.h"
+#include "assetpack.h"
+#include "resources.h"
+#include "streaming.h"
+#include "camerapath.h"
+#ifdef HAVE_EGL
+#include "offscreen.h"
+#endif
 
 using namespace std;
-using namespace tinyxml2;
-
-// Structure to represent a 3D vertex
-struct Vertex {
-    float x, y, z;
-    
-    Vertex() : x(0), y(0), z(0) {}
-    Vertex(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
-};
-
-// Structure to represent a face (triangle)
-struct Face {
-    int v1, v2, v3;  // Vertex indices
-    
-    Face() : v1(0), v2(0), v3(0) {}
-    Face(int _v1, int _v2, int _v3) : v1(_v1), v2(_v2), v3(_v3) {}
-};
-
-// Structure to represent a 3D model with vertices and faces
-struct ModelData {
-    string filename;
-    vector<Vertex> vertices;
-    vector<Face> faces;
-    
-    bool loaded;
-    
-    ModelData() : loaded(false) {}
-};
 
 // Global variables
 Window window;
 Camera* camera;
-vector<ModelData> modelDataList; // List of loaded model data
+Scene scene; // Instances of the models, flattened from the group hierarchy
+ResourceManager resources; // Model data of each file in scene.modelFiles
+AssetPack assetPack; // Kept open while models are streamed from it
+ModelStreamer* streamer = nullptr; // Loads the models near the camera (--stream)
+vector<int> pinnedModels; // Models of the frame being drawn, referenced until it is done
+FrameProfiler profiler;
+BenchmarkConfig benchConfig;
+Benchmark benchmark;
+ThreadPool* workerPool;
+OcclusionCuller* occlusionCuller;
+FramePreparer* framePreparer;
+FramePipeline* framePipeline; // Traversal and culling run one frame ahead of submission
+GLStateCache glState; // All engine GL state changes go through here
+CoreRenderer* coreRenderer = nullptr; // Shader path, used with --core
+StatsDump statsDump; // Periodic render statistics output (--stats)
+CameraInput cameraInput; // Motion keys currently held
+CameraPath recordedPath; // Camera states of the session (--record)
+string recordFile;
+chrono::steady_clock::time_point recordStart;
+chrono::steady_clock::time_point animationStart; // Time 0 of the scene animations
+double animationTime = 0; // Seconds, for the frame being requested
+
+// The offscreen backend advances the animations by a fixed step per frame, so its images are reproducible
+const double OFFSCREEN_FRAME_SECONDS = 1.0 / 60.0;
 
 bool showAxes = false;
 bool wireframeMode = false;
+bool occlusionCulling = true;
+
+// Current viewport size
+int viewportWidth = 0;
+int viewportHeight = 0;
 
 // Function prototypes
-bool loadModel(ModelData& modelData, const string& filename);
 void changeSize(int w, int h);
 void renderScene();
+void drawFrame(const RenderList& list);
+void countGLState();
+void endProfiledFrame();
+FrameRequest currentFrameRequest();
+const RenderList& acquireRenderList();
+int reloadModels(const vector<int>& models);
+bool initGLState();
+void uploadModels();
+void updateSharedBuffer();
+size_t uploadModel(int model);
+int runOffscreen(const EngineOptions& options);
 void drawAxes();
 void processKeys(unsigned char key, int xx, int yy);
+void processKeysUp(unsigned char key, int xx, int yy);
 void processSpecialKeys(int key, int xx, int yy);
+void processSpecialKeysUp(int key, int xx, int yy);
+void idleRedraw();
+void requestRedraw();
+void stopFramePipeline();
+void recordCamera();
+void saveRecording();
 
 int main(int argc, char** argv) {
-    // Check if config file is provided
-    if (argc < 2) {
-        cerr << "Usage: " << argv[0] << " <config.xml>" << endl;
+    // Parse command line options
+    EngineOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        return 1;
+    }
+    if (!options.compileFile.empty()) {
+        return SceneFile::compile(options.configFile, options.compileFile) ? 0 : 1;
+    }
+    benchConfig = options.bench;
+    recordFile = options.recordFile;
+    if (!statsDump.open(options.statsInterval, options.statsFile)) {
         return 1;
     }
     
     // Create camera with default values
     camera = new Camera();
     
-    // Initialize Group to hold models
-    Group group;
-    
-    // Parse the XML file using SimpleParser
-    if (!SimpleParser::parseXMLFile(argv[1], window, *camera, group)) {
+    // Load the scene from an asset pack or a compiled scene, or parse the XML file using SimpleParser
+    string xmlFile = options.configFile;
+    AssetPack& pack = assetPack;
+    if (AssetPack::isPackFile(options.configFile)) {
+        const char* sceneData;
+        size_t sceneSize;
+        if (!pack.open(options.configFile)) {
+            return 1;
+        }
+        if (!pack.find(AssetPack::SCENE_ENTRY, sceneData, sceneSize)) {
+            cerr << "Asset pack has no scene: " << options.configFile << endl;
+            return 1;
+        }
+        if (SceneFile::load(sceneData, sceneSize, options.configFile, window, *camera, scene, nullptr) != SCENE_FILE_OK) {
+            return 1;
+        }
+        xmlFile.clear();
+    } else if (SceneFile::isSceneFile(options.configFile)) {
+        SceneFileResult result = SceneFile::load(options.configFile, window, *camera, scene, xmlFile);
+        if (result == SCENE_FILE_ERROR) {
+            return 1;
+        }
+        if (result == SCENE_FILE_STALE) {
+            cerr << "Compiled scene is older than " << xmlFile << ", reading the XML file instead" << endl;
+        } else {
+            xmlFile.clear();
+        }
+    }
+    if (!xmlFile.empty() && !SimpleParser::parseXMLFile(xmlFile, window, *camera, scene)) {
         cerr << "Failed to parse XML file." << endl;
         return 1;
     }
     
-    // Load all models from the parsed Group
-    for (const Model& model : group.models) {
-        ModelData modelData;
-        if (loadModel(modelData, model.filename)) {
-            modelDataList.push_back(modelData);
+    // Model files are taken from the pack when it has them, then from the search paths
+    for (const string& directory : options.searchPaths) {
+        resources.addSearchPath(directory);
+    }
+    resources.addSearchPath(ResourceManager::DEFAULT_SEARCH_PATH);
+    resources.setBudget(options.cpuBudgetMB << 20, options.gpuBudgetMB << 20);
+    resources.setPack(pack.isOpen() ? &pack : nullptr);
+    resources.setModels(scene.modelFiles);
+    
+    // Each model file is loaded once; a file that fails to load stays in the list, unloaded,
+    // so the instance indices remain valid. The models drawn by a frame are its users
+    // (see acquireRenderList), a budget evicts the others and they are loaded again when
+    // they come back into view. When streaming, the instances near the camera are users
+    // too, and only their models are loaded before the first frame.
+    bool streaming = options.streaming.enabled();
+    bool budget = options.cpuBudgetMB > 0 || options.gpuBudgetMB > 0;
+    if (!streaming) {
+        for (size_t i = 0; i < resources.size(); i++) {
+            resources.load((int) i);
+        }
+        
+        // Evicted models are read again from the pack
+        if (!budget) {
+            resources.setPack(nullptr);
+            pack.close();
         }
     }
     
+    // The hierarchy is static, world matrices and bounds are computed once here
+    scene.updateWorld(resources.models());
+    if (streaming) {
+        streamer = new ModelStreamer(scene, resources);
+        streamer->start(options.streaming, budget, uploadModel);
+        streamer->preload(*camera);
+    }
+    
+    // The software backend renders without creating a window
+    if (options.backend == BACKEND_SOFTWARE) {
+        int result = runSoftwareBackend(options, scene, resources.models(), *camera, window.width, window.height);
+        delete camera;
+        return result;
+    }
+    
+    // Workers for CPU-side frame work such as occlusion culling
+    workerPool = new ThreadPool(options.threads);
+    occlusionCuller = new OcclusionCuller(*workerPool);
+    framePreparer = new FramePreparer(scene, resources.models(), *occlusionCuller);
+    framePreparer->setListUnloaded(!streaming && budget);
+    framePipeline = new FramePipeline(*framePreparer, options.pipelined);
+    
+    // The offscreen backend renders to image files through a surfaceless context
+    if (options.backend == BACKEND_OFFSCREEN) {
+        int result = runOffscreen(options);
+        saveRecording();
+        delete framePipeline;
+        delete streamer;
+        delete framePreparer;
+        delete occlusionCuller;
+        delete workerPool;
+        delete camera;
+        return result;
+    }
+    
+    // GLUT leaves through exit(), join the preparation thread before the models are destroyed
+    atexit(stopFramePipeline);
+    atexit(saveRecording);
+    
+    // Benchmark runs should not be capped by the display refresh rate
+    if (benchConfig.enabled) {
+        Benchmark::disableVsyncEnv();
+    }
+    
     // Initialize GLUT
     glutInit(&argc, argv);
     glutInitDisplayMode(GLUT_DEPTH | GLUT_DOUBLE | GLUT_RGBA);
     glutInitWindowPosition(100, 100);
     glutInitWindowSize(window.width, window.height);
+    if (options.coreProfile) {
+        glutInitContextVersion(3, 3);
+        glutInitContextProfile(GLUT_CORE_PROFILE);
+        coreRenderer = new CoreRenderer();
+    }
     glutCreateWindow("3D Engine - Phase 1");
     
     // Register callback functions
     glutDisplayFunc(renderScene);
     glutReshapeFunc(changeSize);
     glutKeyboardFunc(processKeys);
+    glutKeyboardUpFunc(processKeysUp);
     glutSpecialFunc(processSpecialKeys);
+    glutSpecialUpFunc(processSpecialKeysUp);
     
-    // OpenGL settings
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_CULL_FACE);
+    // Held keys are tracked through the up events, repeats would only add redraws
+    glutIgnoreKeyRepeat(1);
+    
+    if (!initGLState()) {
+        return 1;
+    }
+    
+    // Animated scenes are redrawn continuously
+    animationStart = chrono::steady_clock::now();
+    if (scene.isAnimated()) {
+        glutIdleFunc(idleRedraw);
+    }
+    
+    // Render continuously while benchmarking
+    if (benchConfig.enabled) {
+        Benchmark::disableVsync();
+        if (!benchmark.begin(benchConfig, camera)) {
+            return 1;
+        }
+        glutIdleFunc(idleRedraw);
+        if (benchConfig.pathFile.empty()) {
+            cout << "Benchmark: " << benchConfig.frames << " frames, orbit "
+                 << benchConfig.orbitDegrees << " degrees/frame" << endl;
+        } else {
+            cout << "Benchmark: camera path " << benchConfig.pathFile
+                 << (benchConfig.realtime ? " (real time)" : " (one frame per key)") << endl;
+        }
+    }
     
     // Display keyboard controls
     cout << "\n--- 3D Engine Controls ---" << endl;
-    cout << "Arrow keys: Rotate camera" << endl;
-    cout << "W/S: Zoom in/out" << endl;
+    cout << "Arrow keys (hold): Rotate camera" << endl;
+    cout << "W/S (hold): Zoom in/out" << endl;
     cout << "A: Toggle axes display" << endl;
     cout << "L: Toggle wireframe mode" << endl;
+    cout << "O: Toggle occlusion culling" << endl;
+    cout << "P: Toggle profiler overlay" << endl;
     
     // Enter GLUT main loop
     glutMainLoop();
     
     // Clean up
+    stopFramePipeline();
+    delete coreRenderer;
+    delete framePreparer;
+    delete occlusionCuller;
+    delete workerPool;
     delete camera;
     
     return 0;
 }
 
-// Load a 3D model from file
-bool loadModel(ModelData& modelData, const string& filename) {
-    ifstream file(filename);
-    if (!file.is_open()) {
-        cerr << "Error opening model file: " << filename << endl;
-        return false;
-    }
-    
-    // Set filename
-    modelData.filename = filename;
-    
-    // Clear any existing data
-    modelData.vertices.clear();
-    modelData.faces.clear();
-    
-    // Read the entire file content into a string
-    string content((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
-    file.close();
-    
-    // Parse XML content using TinyXML2
-    XMLDocument doc;
-    if (doc.Parse(content.c_str()) != XML_SUCCESS) {
-        cerr << "Error parsing XML in model file: " << filename << endl;
-        return false;
-    }
-    
-    // Get the root element (should be one of: plane, box, sphere, cone)
-    XMLElement* rootElement = doc.RootElement();
-    if (!rootElement) {
-        cerr << "No root element found in model file: " << filename << endl;
-        return false;
-    }
-    
-    // Maps to store vertex indices
-    map<string, int> vertexIndices;
-    int nextIndex = 0;
-    
-    // Process all triangle elements
-    XMLElement* triangleElement = rootElement->FirstChildElement("triangle");
-    int faceCount = 0;
-    
-    while (triangleElement) {
-        XMLElement* vertex1 = triangleElement->FirstChildElement("vertex");
-        XMLElement* vertex2 = vertex1 ? vertex1->NextSiblingElement("vertex") : nullptr;
-        XMLElement* vertex3 = vertex2 ? vertex2->NextSiblingElement("vertex") : nullptr;
-        
-        if (vertex1 && vertex2 && vertex3) {
-            // Create three vertices for the triangle
-            vector<int> vertexIndicesForTriangle;
-            
-            // Process each vertex of the triangle
-            for (XMLElement* vertex : {vertex1, vertex2, vertex3}) {
-                float x = 0, y = 0, z = 0;
-                vertex->QueryFloatAttribute("x", &x);
-                vertex->QueryFloatAttribute("y", &y);
-                vertex->QueryFloatAttribute("z", &z);
-                
-                // Create a unique key for this vertex
-                string vertexKey = to_string(x) + "," + to_string(y) + "," + to_string(z);
-                
-                // Check if we've seen this vertex before
-                if (vertexIndices.find(vertexKey) == vertexIndices.end()) {
-                    // New vertex, add it to the model
-                    modelData.vertices.push_back(Vertex(x, y, z));
-                    vertexIndices[vertexKey] = nextIndex;
-                    vertexIndicesForTriangle.push_back(nextIndex);
-                    nextIndex++;
-                } else {
-                    // Existing vertex, reuse its index
-                    vertexIndicesForTriangle.push_back(vertexIndices[vertexKey]);
-                }
-            }
-            
-            // Add the face if we have three valid vertices
-            if (vertexIndicesForTriangle.size() == 3) {
-                modelData.faces.push_back(Face(
-                    vertexIndicesForTriangle[0],
-                    vertexIndicesForTriangle[1],
-                    vertexIndicesForTriangle[2]
-                ));
-                faceCount++;
-            }
-        } else {
-            cerr << "Triangle missing vertices in model file: " << filename << endl;
-        }
-        
-        triangleElement = triangleElement->NextSiblingElement("triangle");
-    }
-    
-    modelData.loaded = true;
-    cout << "Model loaded: " << filename << " (" << modelData.vertices.size() << " vertices, " 
-         << faceCount << " faces)" << endl;
-    
-    return true;
-}
-
 // Draw coordinate axes
 void drawAxes() {
     glBegin(GL_LINES);
@@ -234,111 +311,370 @@ void drawAxes() {
     glEnd();
 }
 
+// OpenGL settings shared by the window and offscreen backends
+bool initGLState() {
+    // Face culling is part of each material and set by the render queue
+    glState.invalidate();
+    glState.enable(GL_DEPTH_TEST);
+    
+    // Timer queries for the profiler
+    profiler.initGL();
+    
+    if (coreRenderer) {
+        if (!coreRenderer->init(resources.models(), glState, profiler)) {
+            cerr << "Failed to initialize the core-profile renderer." << endl;
+            return false;
+        }
+        
+        // The models share one buffer, the range of an evicted model is reused by the next uploads
+        for (size_t i = 0; i < resources.size(); i++) {
+            const ModelData& modelData = resources.models()[i];
+            if (modelData.drawBuffer) resources.setGpuBytes((int) i, modelData.drawVertices.size() * sizeof(DrawVertex));
+        }
+        coreRenderer->setBufferLimit(resources.getGpuBudget());
+        resources.setGpuRelease([](ModelData& modelData) { coreRenderer->releaseModel(modelData); });
+        updateSharedBuffer();
+        return true;
+    }
+    
+    resources.setGpuRelease([](ModelData& modelData) { glState.deleteBuffer(modelData.drawBuffer); });
+    uploadModels();
+    return true;
+}
+
+// Copy the baked draw buffers of all loaded models to the GPU
+void uploadModels() {
+    for (size_t i = 0; i < resources.size(); i++) {
+        const ModelData& modelData = resources.models()[i];
+        if (modelData.loaded && !modelData.drawBuffer) uploadModel((int) i);
+    }
+}
+
+// Copy the baked draw buffer of a model to the GPU, returns the bytes sent
+size_t uploadModel(int model) {
+    ModelData& modelData = resources.models()[model];
+    size_t bytes = modelData.drawVertices.size() * sizeof(DrawVertex);
+    size_t uploaded = bytes;
+    if (coreRenderer) {
+        uploaded = coreRenderer->uploadModel(resources.models(), model, glState, profiler);
+    } else {
+        glGenBuffers(1, &modelData.drawBuffer);
+        glState.bindBuffer(GL_ARRAY_BUFFER, modelData.drawBuffer);
+        glBufferData(GL_ARRAY_BUFFER, bytes, modelData.drawVertices.data(), GL_STATIC_DRAW);
+        profiler.countUpload((long) bytes);
+    }
+    resources.setGpuBytes(model, bytes);
+    return uploaded;
+}
+
+// The core path keeps all meshes in one buffer: compact it once evictions left most of it
+// unused or it outgrew the GPU budget, and count its free space as GPU memory
+void updateSharedBuffer() {
+    if (!coreRenderer) return;
+    
+    coreRenderer->trim(resources.models(), glState, profiler);
+    resources.setSharedGpuBytes(coreRenderer->unusedBytes());
+}
+
+// Render frames to image files without a window
+int runOffscreen(const EngineOptions& options) {
+#ifdef HAVE_EGL
+    OffscreenRenderer offscreen(glState);
+    if (!offscreen.init(window.width, window.height, options.coreProfile)) {
+        cerr << "Failed to create the offscreen context." << endl;
+        return 1;
+    }
+    
+    CoreRenderer core;
+    if (options.coreProfile) coreRenderer = &core;
+    if (!initGLState()) {
+        coreRenderer = nullptr;
+        return 1;
+    }
+    changeSize(window.width, window.height);
+    
+    // The camera path is the benchmark orbit, so runs are reproducible
+    BenchmarkConfig path = options.bench;
+    if (!options.bench.enabled) {
+        path.frames = options.frames;
+        path.warmupFrames = 0;
+        path.orbitDegrees = options.orbitDegrees;
+    }
+    
+    Benchmark run;
+    if (!run.begin(path, camera)) {
+        coreRenderer = nullptr;
+        return 1;
+    }
+    int totalFrames = run.frameCount();
+    
+    auto start = chrono::steady_clock::now();
+    int frame = 0;
+    do {
+        run.prepareFrame();
+        recordCamera();
+        animationTime = frame * OFFSCREEN_FRAME_SECONDS;
+        profiler.beginFrame();
+        const RenderList& list = acquireRenderList();
+        
+        // Prepare the next frame while this one is drawn and read back
+        run.prepareNextFrame();
+        animationTime = (frame + 1) * OFFSCREEN_FRAME_SECONDS;
+        framePipeline->request(currentFrameRequest());
+        
+        drawFrame(list);
+        offscreen.endFrame(frameFilename(options.outputFile, frame, totalFrames));
+        endProfiledFrame();
+        frame++;
+    } while (run.endFrame());
+    
+    offscreen.finish();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    
+    cout << "Offscreen: " << frame << " frames in " << seconds << " s (" << frame / seconds << " FPS)" << endl;
+    cout << "Last frame:" << endl;
+    profiler.sample(0).stats.print(cout);
+    if (options.bench.enabled) {
+        run.report();
+    }
+    coreRenderer = nullptr;
+    return 0;
+#else
+    (void) options;
+    cerr << "Offscreen backend not available (built without EGL)." << endl;
+    return 1;
+#endif
+}
+
 // GLUT reshape function
 void changeSize(int w, int h) {
     // Prevent division by zero
     if (h == 0) h = 1;
     
-    // Compute window's aspect ratio
-    float ratio = w * 1.0f / h;
-    
-    // Set the projection matrix
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
+    viewportWidth = w;
+    viewportHeight = h;
     
-    // Set the viewport
+    // Set the viewport and the window's aspect ratio
     glViewport(0, 0, w, h);
+    camera->setAspect(w * 1.0f / h);
     
-    // Set perspective
-    gluPerspective(camera->getFov(), ratio, camera->getNearPlane(), camera->getFarPlane());
+    // The core-profile path takes its projection from the camera uniform block
+    if (coreRenderer) {
+        return;
+    }
+    
+    // Load the camera's perspective matrix
+    glState.matrixMode(GL_PROJECTION);
+    glLoadMatrixf(camera->getProjectionMatrix().m);
     
     // Return to modelview matrix
-    glMatrixMode(GL_MODELVIEW);
+    glState.matrixMode(GL_MODELVIEW);
 }
 
 // GLUT display function
 void renderScene() {
+    // All input since the last frame becomes a single camera update
+    cameraInput.update(*camera);
+    benchmark.prepareFrame();
+    recordCamera();
+    animationTime = chrono::duration<double>(chrono::steady_clock::now() - animationStart).count();
+    profiler.beginFrame();
+    const RenderList& list = acquireRenderList();
+    if (streamer && streamer->pending() > 0) {
+        glutIdleFunc(idleRedraw);
+    }
+    
+    // Start preparing the next frame from the next view while this one is submitted;
+    // if input moves the camera before then, acquireRenderList() prepares it again
+    benchmark.prepareNextFrame();
+    framePipeline->request(currentFrameRequest());
+    
+    drawFrame(list);
+    
+    // Draw the profiler overlay on top of the scene
+    if (profiler.isOverlayVisible()) {
+        profiler.drawOverlay(viewportWidth, viewportHeight, glState);
+    }
+    
+    // Swap buffers
+    glutSwapBuffers();
+    
+    endProfiledFrame();
+    
+    if (benchmark.isRunning() && !benchmark.endFrame()) {
+        benchmark.report();
+        exit(0);
+    }
+}
+
+// View parameters the next render list is prepared for
+FrameRequest currentFrameRequest() {
+    FrameRequest request;
+    request.camera = *camera;
+    request.culling = occlusionCulling;
+    request.wireframe = wireframeMode;
+    request.time = animationTime;
+    return request;
+}
+
+// Move the state cache counters of the frame into the profiler
+void countGLState() {
+    const GLStateStats& stats = glState.getStats();
+    profiler.countStateChanges(stats.issued, stats.filtered);
+    glState.resetStats();
+}
+
+// Close the frame in the profiler and dump its statistics if requested
+void endProfiledFrame() {
+    countGLState();
+    
+    for (int model : pinnedModels) {
+        resources.release(model);
+    }
+    pinnedModels.clear();
+    const ResourceStats& resourceStats = resources.getStats();
+    profiler.setResources(resourceStats.resident, (long) resourceStats.cpuBytes, (long) resourceStats.gpuBytes,
+                          resourceStats.evictions, resourceStats.reloads, streamer ? streamer->pending() : 0);
+    profiler.endFrame();
+    
+    const FrameSample& last = profiler.sample(0);
+    statsDump.frameDone(profiler.finishedFrames() - 1, last.frameMs, last.stats);
+}
+
+// Get the render list of the current frame and account for its preparation
+const RenderList& acquireRenderList() {
+    FrameRequest request = currentFrameRequest();
+    const RenderList* prepared = &framePipeline->acquire(request);
+    
+    // Nothing reads the scene or the models until the next frame is requested: models
+    // are loaded and evicted here, on the GL thread. Visible instances whose model was
+    // evicted bring it back, and the list is prepared again with them.
+    if (reloadModels(prepared->unloadedModels) > 0) {
+        framePipeline->request(request);
+        prepared = &framePipeline->acquire(request);
+    }
+    const RenderList& list = *prepared;
+    profiler.addSectionMs(PROFILE_TRAVERSAL, list.traversalMs);
+    profiler.addSectionMs(PROFILE_CULLING, list.cullingMs);
+    profiler.addSectionMs(PROFILE_SORTING, list.sortingMs);
+    profiler.countObjects(list.visited, list.frustumCulled, list.occluded);
+    profiler.countSceneUpdate(list.sceneUpdate.groups, list.sceneUpdate.instances);
+    
+    // The models of this list stay until it is drawn
+    const ModelData* models = resources.models().data();
+    for (const DrawItem& item : list.queue.getItems()) {
+        int model = (int) (item.model - models);
+        resources.addRef(model);
+        pinnedModels.push_back(model);
+    }
+    if (streamer) {
+        streamer->update(list.request.camera);
+    } else {
+        resources.enforceBudget();
+    }
+    updateSharedBuffer();
+    return list;
+}
+
+// Load and upload the evicted models of a render list again, returns how many came back
+int reloadModels(const vector<int>& models) {
+    int reloaded = 0;
+    for (int model : models) {
+        if (resources.reload(model)) {
+            uploadModel(model);
+            reloaded++;
+        }
+    }
+    return reloaded;
+}
+
+// Draw a prepared render list into the current framebuffer
+void drawFrame(const RenderList& list) {
+    profiler.beginGpu();
+    
     // Clear buffers
-    glDisable(GL_CULL_FACE);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     
-    // Set polygon drawing mode
-    if (wireframeMode) {
-        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-    } else {
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    // Shader path: camera uniforms and a few multi-draw calls
+    if (coreRenderer) {
+        ProfileScope scope(profiler, PROFILE_SUBMISSION);
+        coreRenderer->drawFrame(list, showAxes, glState, profiler);
+        profiler.endGpu();
+        return;
     }
     
-    // Set the camera
-    glLoadIdentity();
-    camera->place();
+    // Set the camera the list was prepared for (skipped while the camera does not move)
+    const Mat4& view = list.request.camera.getViewMatrix();
+    glState.loadModelView(view);
     
     // Draw axes if enabled
     if (showAxes) {
         drawAxes();
+        profiler.countDraw(0, 0, 6);
     }
     
-    // Render all models
-    for (const ModelData& modelData : modelDataList) {
-        if (!modelData.loaded) continue;
-        
-        // If model has faces defined, use them for rendering
-        if (!modelData.faces.empty()) {
-            glBegin(GL_TRIANGLES);
-            for (const Face& face : modelData.faces) {
-                // Use alternating colors for triangles
-                static int colorToggle = 0;
-                if (colorToggle % 2 == 0) {
-                    glColor3f(0.8f, 0.6f, 0.2f);  // Orange-ish
-                } else {
-                    glColor3f(0.2f, 0.6f, 0.8f);  // Blue-ish
-                }
-                colorToggle++;
-                
-                // Draw the triangle
-                const Vertex& v1 = modelData.vertices[face.v1];
-                const Vertex& v2 = modelData.vertices[face.v2];
-                const Vertex& v3 = modelData.vertices[face.v3];
-                
-                glVertex3f(v1.x, v1.y, v1.z);
-                glVertex3f(v2.x, v2.y, v2.z);
-                glVertex3f(v3.x, v3.y, v3.z);
-            }
-            glEnd();
-        } else {
-            // No faces defined, render vertices directly in triangle order
-            glBegin(GL_TRIANGLES);
-            for (size_t i = 0; i < modelData.vertices.size(); i += 3) {
-                if (i + 2 < modelData.vertices.size()) {
-                    // Use alternating colors for triangles
-                    static int colorToggle = 0;
-                    if (colorToggle % 2 == 0) {
-                        glColor3f(0.8f, 0.6f, 0.2f);  // Orange-ish
-                    } else {
-                        glColor3f(0.2f, 0.6f, 0.8f);  // Blue-ish
-                    }
-                    colorToggle++;
-                    
-                    // Draw the triangle
-                    const Vertex& v1 = modelData.vertices[i];
-                    const Vertex& v2 = modelData.vertices[i + 1];
-                    const Vertex& v3 = modelData.vertices[i + 2];
-                    
-                    glVertex3f(v1.x, v1.y, v1.z);
-                    glVertex3f(v2.x, v2.y, v2.z);
-                    glVertex3f(v3.x, v3.y, v3.z);
-                }
-            }
-            glEnd();
-        }
+    // Render the sorted queue, only changing the GL state that differs between draws
+    {
+        ProfileScope scope(profiler, PROFILE_SUBMISSION);
+        submitQueue(list.queue, view, glState, profiler);
     }
     
-    // Swap buffers
-    glutSwapBuffers();
+    profiler.endGpu();
+}
+
+void stopFramePipeline() {
+    delete framePipeline;
+    framePipeline = nullptr;
+    delete streamer;
+    streamer = nullptr;
+}
+
+// Add the view of the frame about to be drawn to the recorded path
+void recordCamera() {
+    if (recordFile.empty()) return;
+    
+    auto now = chrono::steady_clock::now();
+    if (recordedPath.size() == 0) {
+        recordStart = now;
+    }
+    recordedPath.add(chrono::duration<float>(now - recordStart).count(), *camera);
+}
+
+void saveRecording() {
+    if (recordFile.empty() || recordedPath.size() == 0) return;
+    
+    if (recordedPath.save(recordFile)) {
+        cout << "Camera path: " << recordedPath.size() << " keys, " << recordedPath.duration()
+             << " s written to " << recordFile << endl;
+    }
+}
+
+// GLUT idle function: render back to back while benchmarking, while a motion key is held,
+// while the scene is animated or while streamed models are on their way
+void idleRedraw() {
+    if (benchmark.isRunning() || cameraInput.isMoving() || scene.isAnimated() || (streamer && streamer->pending() > 0)) {
+        glutPostRedisplay();
+    } else {
+        glutIdleFunc(nullptr);
+    }
+}
+
+// Redraw once, or continuously while the camera moves
+void requestRedraw() {
+    glutPostRedisplay();
+    if (cameraInput.isMoving()) {
+        glutIdleFunc(idleRedraw);
+    }
 }
 
 // Keyboard input processing
 void processKeys(unsigned char key, int xx, int yy) {
+    // W/S zoom for as long as they are held
+    if (cameraInput.keyDown(key, *camera)) {
+        requestRedraw();
+        return;
+    }
+    
     switch (key) {
         case 'a':
         case 'A':
@@ -350,14 +686,18 @@ void processKeys(unsigned char key, int xx, int yy) {
             wireframeMode = !wireframeMode;
             break;
         
-        case 'w':
-        case 'W':
-            camera->zoomIn();
+        case 'o':
+        case 'O':
+            occlusionCulling = !occlusionCulling;
             break;
         
-        case 's':
-        case 'S':
-            camera->zoomOut();
+        case 'p':
+        case 'P':
+            if (coreRenderer) {
+                cout << "The profiler overlay needs the fixed-function path (run without --core)." << endl;
+            } else {
+                profiler.toggleOverlay();
+            }
             break;
         
         case 27:  // Escape key
@@ -365,28 +705,24 @@ void processKeys(unsigned char key, int xx, int yy) {
             break;
     }
     
-    glutPostRedisplay();
+    requestRedraw();
 }
 
-// Special key input processing
+void processKeysUp(unsigned char key, int xx, int yy) {
+    if (cameraInput.keyUp(key, *camera)) {
+        requestRedraw();
+    }
+}
+
+// Special key input processing: the arrow keys rotate while held
 void processSpecialKeys(int key, int xx, int yy) {
-    switch (key) {
-        case GLUT_KEY_UP:
-            camera->rotateUp();
-            break;
-        
-        case GLUT_KEY_DOWN:
-            camera->rotateDown();
-            break;
-        
-        case GLUT_KEY_LEFT:
-            camera->rotateLeft();
-            break;
-        
-        case GLUT_KEY_RIGHT:
-            camera->rotateRight();
-            break;
+    if (cameraInput.specialDown(key, *camera)) {
+        requestRedraw();
     }
-    
-    glutPostRedisplay();
-}
\ No newline at end of file
+}
+
+void processSpecialKeysUp(int key, int xx, int yy) {
+    if (cameraInput.specialUp(key, *camera)) {
+        requestRedraw();
+    }
+}
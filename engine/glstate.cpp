@@ -0,0 +1,136 @@
+#define GL_GLEXT_PROTOTYPES
+#include "glstate.h"
+#include "model.h"
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <cstddef>
+#include <cstring>
+
+const GLStateCache::Entry* GLStateCache::Table::find(unsigned int key) const {
+    for (int i = 0; i < count; i++) {
+        if (entries[i].key == key) return &entries[i];
+    }
+    return nullptr;
+}
+
+bool GLStateCache::Table::update(unsigned int key, unsigned int value) {
+    for (int i = 0; i < count; i++) {
+        if (entries[i].key == key) {
+            if (entries[i].value == value) return false;
+            entries[i].value = value;
+            return true;
+        }
+    }
+
+    // Untracked keys beyond the table size are simply never filtered
+    if (count < MAX_TRACKED) {
+        entries[count].key = key;
+        entries[count].value = value;
+        count++;
+    }
+    return true;
+}
+
+GLStateCache::GLStateCache() {
+    invalidate();
+}
+
+void GLStateCache::invalidate() {
+    capabilities.count = 0;
+    clientStates.count = 0;
+    buffers.count = 0;
+    currentPolygonMode = -1;
+    currentProgram = -1;
+    currentVertexArray = -1;
+    arraysBuffer = -1;
+    currentMatrixMode = -1;
+    modelViewKnown = false;
+}
+
+bool GLStateCache::changed(bool isChanged) {
+    if (isChanged) stats.issued++;
+    else stats.filtered++;
+    return isChanged;
+}
+
+void GLStateCache::setEnabled(unsigned int capability, bool enabled) {
+    if (!changed(capabilities.update(capability, enabled ? 1 : 0))) return;
+
+    if (enabled) glEnable(capability);
+    else glDisable(capability);
+}
+
+bool GLStateCache::isEnabled(unsigned int capability) const {
+    const Entry* entry = capabilities.find(capability);
+    if (entry) return entry->value != 0;
+    return glIsEnabled(capability) == GL_TRUE;
+}
+
+void GLStateCache::setClientState(unsigned int array, bool enabled) {
+    if (!changed(clientStates.update(array, enabled ? 1 : 0))) return;
+
+    if (enabled) glEnableClientState(array);
+    else glDisableClientState(array);
+}
+
+void GLStateCache::polygonMode(unsigned int mode) {
+    if (!changed(currentPolygonMode != (int) mode)) return;
+
+    glPolygonMode(GL_FRONT_AND_BACK, mode);
+    currentPolygonMode = (int) mode;
+}
+
+void GLStateCache::bindBuffer(unsigned int target, unsigned int buffer) {
+    if (!changed(buffers.update(target, buffer))) return;
+
+    glBindBuffer(target, buffer);
+}
+
+void GLStateCache::deleteBuffer(unsigned int buffer) {
+    if (!buffer) return;
+
+    glDeleteBuffers(1, &buffer);
+    for (int i = 0; i < buffers.count; i++) {
+        if (buffers.entries[i].value == buffer) buffers.entries[i].value = 0;
+    }
+    if (arraysBuffer == (long) buffer) arraysBuffer = -1;
+}
+
+void GLStateCache::useProgram(unsigned int program) {
+    if (!changed(currentProgram != (long) program)) return;
+
+    glUseProgram(program);
+    currentProgram = program;
+}
+
+void GLStateCache::bindVertexArray(unsigned int vertexArray) {
+    if (!changed(currentVertexArray != (long) vertexArray)) return;
+
+    glBindVertexArray(vertexArray);
+    currentVertexArray = vertexArray;
+}
+
+void GLStateCache::drawVertexArrays(unsigned int buffer) {
+    bindBuffer(GL_ARRAY_BUFFER, buffer);
+    if (!changed(arraysBuffer != (long) buffer)) return;
+
+    glVertexPointer(3, GL_FLOAT, sizeof(DrawVertex), (const void*) offsetof(DrawVertex, x));
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(DrawVertex), (const void*) offsetof(DrawVertex, r));
+    arraysBuffer = buffer;
+}
+
+void GLStateCache::matrixMode(unsigned int mode) {
+    if (!changed(currentMatrixMode != (int) mode)) return;
+
+    glMatrixMode(mode);
+    currentMatrixMode = (int) mode;
+}
+
+void GLStateCache::loadModelView(const Mat4& matrix) {
+    matrixMode(GL_MODELVIEW);
+    if (!changed(!modelViewKnown || memcmp(modelView.m, matrix.m, sizeof(matrix.m)) != 0)) return;
+
+    glLoadMatrixf(matrix.m);
+    modelView = matrix;
+    modelViewKnown = true;
+}
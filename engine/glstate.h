@@ -0,0 +1,86 @@
+#pragma once
+#include "matrix.h"
+
+// Calls issued to and filtered out by the state cache since the last reset
+struct GLStateStats {
+    long issued;
+    long filtered;
+
+    GLStateStats() : issued(0), filtered(0) {}
+};
+
+// Thin layer the engine's GL state calls go through. It remembers the state it
+// has set and drops calls that would not change anything. Everything starts as
+// unknown, so the first call for each piece of state always reaches the driver.
+// Code that changes tracked state behind its back must call invalidate().
+class GLStateCache {
+public:
+    static const int MAX_TRACKED = 16; // Capabilities / buffer targets tracked at once
+
+    GLStateCache();
+
+    // Forget everything, e.g. after a new context was made current
+    void invalidate();
+
+    // glEnable / glDisable
+    void enable(unsigned int capability) { setEnabled(capability, true); }
+    void disable(unsigned int capability) { setEnabled(capability, false); }
+    void setEnabled(unsigned int capability, bool enabled);
+    bool isEnabled(unsigned int capability) const;
+
+    // glEnableClientState / glDisableClientState
+    void setClientState(unsigned int array, bool enabled);
+
+    // glPolygonMode for both faces
+    void polygonMode(unsigned int mode);
+
+    void bindBuffer(unsigned int target, unsigned int buffer);
+
+    // glDeleteBuffers for one buffer. GL unbinds a deleted buffer and may hand its
+    // name out again, so the bindings and pointers naming it are forgotten too.
+    void deleteBuffer(unsigned int buffer);
+    void useProgram(unsigned int program);
+    void bindVertexArray(unsigned int vertexArray);
+
+    // Fixed-function vertex and color pointers into a buffer of DrawVertex
+    void drawVertexArrays(unsigned int buffer);
+
+    // glMatrixMode, and glLoadMatrixf on the modelview matrix
+    void matrixMode(unsigned int mode);
+    void loadModelView(const Mat4& matrix);
+
+    const GLStateStats& getStats() const { return stats; }
+    void resetStats() { stats = GLStateStats(); }
+
+private:
+    struct Entry {
+        unsigned int key;
+        unsigned int value;
+    };
+
+    // Small linear tables: a handful of entries is faster to scan than a map
+    struct Table {
+        Entry entries[MAX_TRACKED];
+        int count;
+
+        Table() : count(0) {}
+        const Entry* find(unsigned int key) const;
+        bool update(unsigned int key, unsigned int value); // False if it already had the value
+    };
+
+    bool changed(bool isChanged);
+
+    Table capabilities;
+    Table clientStates;
+    Table buffers;
+
+    int currentPolygonMode;  // -1 = unknown
+    long currentProgram;     // -1 = unknown
+    long currentVertexArray; // -1 = unknown
+    long arraysBuffer;       // Buffer the vertex/color pointers were set from, -1 = unknown
+    int currentMatrixMode;   // -1 = unknown
+    bool modelViewKnown;
+    Mat4 modelView;
+
+    GLStateStats stats;
+};
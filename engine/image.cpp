@@ -0,0 +1,72 @@
+#include "image.h"
+#include <cstdio>
+#include <iostream>
+#ifdef HAVE_PNG
+#include <png.h>
+#endif
+
+using namespace std;
+
+static bool hasExtension(const string& filename, const string& extension) {
+    return filename.size() >= extension.size() &&
+           filename.compare(filename.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+static bool writePPM(const string& filename, int width, int height, const unsigned char* rgb) {
+    FILE* file = fopen(filename.c_str(), "wb");
+    if (!file) {
+        cerr << "Error opening image file: " << filename << endl;
+        return false;
+    }
+
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+    size_t size = (size_t) width * height * 3;
+    bool ok = fwrite(rgb, 1, size, file) == size;
+    fclose(file);
+    return ok;
+}
+
+#ifdef HAVE_PNG
+static bool writePNG(const string& filename, int width, int height, const unsigned char* rgb) {
+    FILE* file = fopen(filename.c_str(), "wb");
+    if (!file) {
+        cerr << "Error opening image file: " << filename << endl;
+        return false;
+    }
+
+    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    png_infop info = png ? png_create_info_struct(png) : nullptr;
+    if (!png || !info || setjmp(png_jmpbuf(png))) {
+        png_destroy_write_struct(&png, &info);
+        fclose(file);
+        return false;
+    }
+
+    png_init_io(png, file);
+    // Fast compression, these images are written every frame in throughput runs
+    png_set_compression_level(png, 1);
+    png_set_IHDR(png, info, width, height, 8, PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE,
+                 PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(png, info);
+    for (int y = 0; y < height; y++) {
+        png_write_row(png, (png_const_bytep) (rgb + (size_t) y * width * 3));
+    }
+    png_write_end(png, nullptr);
+
+    png_destroy_write_struct(&png, &info);
+    fclose(file);
+    return true;
+}
+#endif
+
+bool writeImage(const string& filename, int width, int height, const unsigned char* rgb) {
+    if (hasExtension(filename, ".png")) {
+#ifdef HAVE_PNG
+        return writePNG(filename, width, height, rgb);
+#else
+        cerr << "PNG output not available (built without libpng): " << filename << endl;
+        return false;
+#endif
+    }
+    return writePPM(filename, width, height, rgb);
+}
@@ -0,0 +1,6 @@
+#pragma once
+#include <string>
+
+// Write an 8-bit RGB image (rows top to bottom, tightly packed).
+// The format is chosen from the extension: .png (when built with libpng) or .ppm.
+bool writeImage(const std::string& filename, int width, int height, const unsigned char* rgb);
@@ -0,0 +1,72 @@
+#include "input.h"
+#include <GL/glut.h>
+#include <algorithm>
+
+using namespace std;
+
+CameraInput::CameraInput()
+    : lastUpdate(Clock::now()), left(false), right(false), up(false), down(false), zoomIn(false), zoomOut(false) {}
+
+bool CameraInput::isMoving() const {
+    return left || right || up || down || zoomIn || zoomOut;
+}
+
+void CameraInput::update(Camera& camera) {
+    Clock::time_point now = Clock::now();
+    double seconds = min(chrono::duration<double>(now - lastUpdate).count(), MAX_STEP);
+    lastUpdate = now;
+    if (!isMoving()) return;
+
+    float angle = ROTATE_SPEED * (float) seconds;
+    float distance = ZOOM_SPEED * (float) seconds;
+    if (left) camera.rotateLeft(angle);
+    if (right) camera.rotateRight(angle);
+    if (up) camera.rotateUp(angle);
+    if (down) camera.rotateDown(angle);
+    if (zoomIn) camera.zoomIn(distance);
+    if (zoomOut) camera.zoomOut(distance);
+}
+
+bool CameraInput::setKey(bool* key, bool isDown, Camera& camera) {
+    if (!key) return false;
+
+    // Motion so far belongs to the previous set of held keys
+    update(camera);
+    *key = isDown;
+    return true;
+}
+
+// Shift may change between press and release, so both cases map to the same key
+bool* CameraInput::keyFlag(unsigned char key) {
+    switch (key) {
+        case 'w': case 'W': return &zoomIn;
+        case 's': case 'S': return &zoomOut;
+    }
+    return nullptr;
+}
+
+bool* CameraInput::specialFlag(int key) {
+    switch (key) {
+        case GLUT_KEY_LEFT: return &left;
+        case GLUT_KEY_RIGHT: return &right;
+        case GLUT_KEY_UP: return &up;
+        case GLUT_KEY_DOWN: return &down;
+    }
+    return nullptr;
+}
+
+bool CameraInput::keyDown(unsigned char key, Camera& camera) {
+    return setKey(keyFlag(key), true, camera);
+}
+
+bool CameraInput::keyUp(unsigned char key, Camera& camera) {
+    return setKey(keyFlag(key), false, camera);
+}
+
+bool CameraInput::specialDown(int key, Camera& camera) {
+    return setKey(specialFlag(key), true, camera);
+}
+
+bool CameraInput::specialUp(int key, Camera& camera) {
+    return setKey(specialFlag(key), false, camera);
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <chrono>
+#include "camera.h"
+
+// Keys held down that move the camera continuously. The motion is integrated
+// over the time each key is held, so it does not depend on the frame rate or
+// on the keyboard repeat rate.
+class CameraInput {
+public:
+    static constexpr float ROTATE_SPEED = 1.5f; // Radians per second
+    static constexpr float ZOOM_SPEED = 3.0f;   // Scene units per second
+    static constexpr double MAX_STEP = 0.25;    // Longest interval integrated at once (s), e.g. after a stall
+
+    CameraInput();
+
+    // Key events (W/S and the arrow keys). They first apply the motion of the keys
+    // already held, then return true if the key is one that moves the camera.
+    bool keyDown(unsigned char key, Camera& camera);
+    bool keyUp(unsigned char key, Camera& camera);
+    bool specialDown(int key, Camera& camera);
+    bool specialUp(int key, Camera& camera);
+
+    bool isMoving() const;
+
+    // Move the camera by the motion of the held keys since the last update
+    void update(Camera& camera);
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    bool* keyFlag(unsigned char key);
+    bool* specialFlag(int key);
+    bool setKey(bool* key, bool down, Camera& camera);
+
+    Clock::time_point lastUpdate;
+    bool left, right, up, down, zoomIn, zoomOut;
+};
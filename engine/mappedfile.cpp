@@ -0,0 +1,54 @@
+#include "mappedfile.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+MappedFile::MappedFile() : base(nullptr), fileSize(0), mappedSize(0) {}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const string& filename) {
+    close();
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        if (fd >= 0) ::close(fd);
+        return false;
+    }
+
+    // Reserve one byte more than the file, zero filled, then map the file over the start
+    // of it: the byte after the file is 0 even when the file ends on a page boundary
+    size_t size = (size_t) info.st_size;
+    void* reserved = mmap(nullptr, size + 1, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (reserved == MAP_FAILED) {
+        ::close(fd);
+        return false;
+    }
+    if (size > 0 && mmap(reserved, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(reserved, size + 1);
+        ::close(fd);
+        return false;
+    }
+    ::close(fd);
+
+    // Parsers go through the file once, front to back
+    if (size > 0) madvise(reserved, size, MADV_SEQUENTIAL);
+
+    base = (char*) reserved;
+    fileSize = size;
+    mappedSize = size + 1;
+    return true;
+}
+
+void MappedFile::close() {
+    if (base) munmap(base, mappedSize);
+    base = nullptr;
+    fileSize = 0;
+    mappedSize = 0;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// A whole file mapped private and writable, followed by a 0, for parsers that work in
+// place (XMLDocument::ParseInSitu). Pages are read from the file as they are touched
+// and copied only when written; writes never reach the file. Replaces reading the file
+// into a string that the parser would then copy again.
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& filename);
+    void close();
+    bool isOpen() const { return base != nullptr; }
+
+    // size() characters of the file, then a 0; valid until the file is closed
+    char* data() const { return base; }
+    size_t size() const { return fileSize; }
+
+private:
+    char* base;
+    size_t fileSize;
+    size_t mappedSize;
+};
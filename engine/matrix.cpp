@@ -0,0 +1,130 @@
+#define _USE_MATH_DEFINES
+#include "matrix.h"
+#include <math.h>
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+Mat4::Mat4() {
+    for (int i = 0; i < 16; i++) m[i] = 0.0f;
+}
+
+Mat4 Mat4::identity() {
+    Mat4 result;
+    result.m[0] = result.m[5] = result.m[10] = result.m[15] = 1.0f;
+    return result;
+}
+
+Mat4 Mat4::lookAt(float eyeX, float eyeY, float eyeZ,
+                  float centerX, float centerY, float centerZ,
+                  float upX, float upY, float upZ) {
+    // Forward direction
+    float fx = centerX - eyeX, fy = centerY - eyeY, fz = centerZ - eyeZ;
+    float len = sqrtf(fx * fx + fy * fy + fz * fz);
+    if (len > 0.0f) { fx /= len; fy /= len; fz /= len; }
+
+    // Side = forward x up
+    float sx = fy * upZ - fz * upY;
+    float sy = fz * upX - fx * upZ;
+    float sz = fx * upY - fy * upX;
+    len = sqrtf(sx * sx + sy * sy + sz * sz);
+    if (len > 0.0f) { sx /= len; sy /= len; sz /= len; }
+
+    // Recomputed up = side x forward
+    float ux = sy * fz - sz * fy;
+    float uy = sz * fx - sx * fz;
+    float uz = sx * fy - sy * fx;
+
+    Mat4 result = identity();
+    result.at(0, 0) = sx;  result.at(0, 1) = sy;  result.at(0, 2) = sz;
+    result.at(1, 0) = ux;  result.at(1, 1) = uy;  result.at(1, 2) = uz;
+    result.at(2, 0) = -fx; result.at(2, 1) = -fy; result.at(2, 2) = -fz;
+    result.at(0, 3) = -(sx * eyeX + sy * eyeY + sz * eyeZ);
+    result.at(1, 3) = -(ux * eyeX + uy * eyeY + uz * eyeZ);
+    result.at(2, 3) = fx * eyeX + fy * eyeY + fz * eyeZ;
+    return result;
+}
+
+Mat4 Mat4::perspective(float fov, float aspect, float near, float far) {
+    float f = 1.0f / tanf(fov * (float) M_PI / 360.0f);
+
+    Mat4 result;
+    result.at(0, 0) = f / aspect;
+    result.at(1, 1) = f;
+    result.at(2, 2) = (far + near) / (near - far);
+    result.at(2, 3) = 2.0f * far * near / (near - far);
+    result.at(3, 2) = -1.0f;
+    return result;
+}
+
+Mat4 Mat4::translation(float x, float y, float z) {
+    Mat4 result = identity();
+    result.at(0, 3) = x;
+    result.at(1, 3) = y;
+    result.at(2, 3) = z;
+    return result;
+}
+
+Mat4 Mat4::rotation(float angle, float x, float y, float z) {
+    float len = sqrtf(x * x + y * y + z * z);
+    if (len == 0.0f) return identity();
+    x /= len; y /= len; z /= len;
+
+    float radians = angle * (float) M_PI / 180.0f;
+    float c = cosf(radians), s = sinf(radians), t = 1.0f - c;
+
+    Mat4 result = identity();
+    result.at(0, 0) = x * x * t + c;     result.at(0, 1) = x * y * t - z * s; result.at(0, 2) = x * z * t + y * s;
+    result.at(1, 0) = y * x * t + z * s; result.at(1, 1) = y * y * t + c;     result.at(1, 2) = y * z * t - x * s;
+    result.at(2, 0) = z * x * t - y * s; result.at(2, 1) = z * y * t + x * s; result.at(2, 2) = z * z * t + c;
+    return result;
+}
+
+Mat4 Mat4::scaling(float x, float y, float z) {
+    Mat4 result = identity();
+    result.at(0, 0) = x;
+    result.at(1, 1) = y;
+    result.at(2, 2) = z;
+    return result;
+}
+
+Mat4 Mat4::operator*(const Mat4& other) const {
+    Mat4 result;
+#ifdef __SSE__
+    // Each result column is a combination of this matrix's columns
+    __m128 c0 = _mm_load_ps(m), c1 = _mm_load_ps(m + 4), c2 = _mm_load_ps(m + 8), c3 = _mm_load_ps(m + 12);
+    for (int col = 0; col < 4; col++) {
+        const float* b = other.m + col * 4;
+        __m128 sum = _mm_mul_ps(c0, _mm_set1_ps(b[0]));
+        sum = _mm_add_ps(sum, _mm_mul_ps(c1, _mm_set1_ps(b[1])));
+        sum = _mm_add_ps(sum, _mm_mul_ps(c2, _mm_set1_ps(b[2])));
+        sum = _mm_add_ps(sum, _mm_mul_ps(c3, _mm_set1_ps(b[3])));
+        _mm_store_ps(result.m + col * 4, sum);
+    }
+#else
+    for (int col = 0; col < 4; col++) {
+        for (int row = 0; row < 4; row++) {
+            float sum = 0.0f;
+            for (int k = 0; k < 4; k++) {
+                sum += at(row, k) * other.at(k, col);
+            }
+            result.at(row, col) = sum;
+        }
+    }
+#endif
+    return result;
+}
+
+void Mat4::transformPoint(float x, float y, float z, float out[4]) const {
+#ifdef __SSE__
+    __m128 sum = _mm_mul_ps(_mm_load_ps(m), _mm_set1_ps(x));
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(m + 4), _mm_set1_ps(y)));
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(m + 8), _mm_set1_ps(z)));
+    sum = _mm_add_ps(sum, _mm_load_ps(m + 12));
+    _mm_storeu_ps(out, sum);
+#else
+    for (int row = 0; row < 4; row++) {
+        out[row] = at(row, 0) * x + at(row, 1) * y + at(row, 2) * z + at(row, 3);
+    }
+#endif
+}
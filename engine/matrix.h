@@ -0,0 +1,32 @@
+#pragma once
+
+// 4x4 matrix stored in column-major order, the same layout OpenGL uses.
+// Aligned so each column can be loaded into one SSE register.
+struct alignas(16) Mat4 {
+    float m[16];
+
+    Mat4();
+
+    static Mat4 identity();
+
+    // Equivalent of gluLookAt
+    static Mat4 lookAt(float eyeX, float eyeY, float eyeZ,
+                       float centerX, float centerY, float centerZ,
+                       float upX, float upY, float upZ);
+
+    // Equivalent of gluPerspective (fov in degrees)
+    static Mat4 perspective(float fov, float aspect, float near, float far);
+
+    // Equivalents of glTranslatef, glRotatef (angle in degrees) and glScalef
+    static Mat4 translation(float x, float y, float z);
+    static Mat4 rotation(float angle, float x, float y, float z);
+    static Mat4 scaling(float x, float y, float z);
+
+    Mat4 operator*(const Mat4& other) const;
+
+    // Multiply the point (x, y, z, 1), writing the homogeneous result
+    void transformPoint(float x, float y, float z, float out[4]) const;
+
+    float& at(int row, int col) { return m[col * 4 + row]; }
+    float at(int row, int col) const { return m[col * 4 + row]; }
+};
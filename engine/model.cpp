@@ -0,0 +1,203 @@
+#include "model.h"
+#include <iostream>
+#include <map>
+#include "mappedfile.h"
+#include "tinyxml2.h"
+
+using namespace std;
+using namespace tinyxml2;
+
+// Alternating triangle colors
+static const DrawVertex COLOR_ORANGE = {0, 0, 0, 204, 153, 51, 255};  // (0.8, 0.6, 0.2)
+static const DrawVertex COLOR_BLUE = {0, 0, 0, 51, 153, 204, 255};    // (0.2, 0.6, 0.8)
+
+// Expand the indexed triangles into the draw buffer, alternating colors per face.
+// Colors depend only on the face index, so every frame looks the same.
+void bakeDrawVertices(ModelData& modelData) {
+    size_t faceCount = modelData.faces.empty() ? modelData.vertices.size() / 3 : modelData.faces.size();
+    
+    modelData.drawVertices.clear();
+    modelData.drawVertices.reserve(faceCount * 3);
+    
+    for (size_t f = 0; f < faceCount; f++) {
+        int indices[3];
+        if (modelData.faces.empty()) {
+            indices[0] = (int) (f * 3); indices[1] = (int) (f * 3 + 1); indices[2] = (int) (f * 3 + 2);
+        } else {
+            indices[0] = modelData.faces[f].v1; indices[1] = modelData.faces[f].v2; indices[2] = modelData.faces[f].v3;
+        }
+        
+        DrawVertex vertex = f % 2 == 0 ? COLOR_ORANGE : COLOR_BLUE;
+        for (int index : indices) {
+            const Vertex& v = modelData.vertices[index];
+            vertex.x = v.x;
+            vertex.y = v.y;
+            vertex.z = v.z;
+            modelData.drawVertices.push_back(vertex);
+        }
+    }
+    
+    // Bounding box, used for culling
+    for (int c = 0; c < 3; c++) {
+        modelData.boundsMin[c] = modelData.vertices.empty() ? 0.0f : 1e30f;
+        modelData.boundsMax[c] = modelData.vertices.empty() ? 0.0f : -1e30f;
+    }
+    for (const Vertex& v : modelData.vertices) {
+        const float p[3] = {v.x, v.y, v.z};
+        for (int c = 0; c < 3; c++) {
+            if (p[c] < modelData.boundsMin[c]) modelData.boundsMin[c] = p[c];
+            if (p[c] > modelData.boundsMax[c]) modelData.boundsMax[c] = p[c];
+        }
+    }
+}
+
+// Read the triangles of a parsed model file
+static bool readModel(ModelData& modelData, const string& filename, XMLDocument& doc) {
+    // Set filename
+    modelData.filename = filename;
+    
+    // Clear any existing data
+    modelData.vertices.clear();
+    modelData.faces.clear();
+    
+    // Get the root element (should be one of: plane, box, sphere, cone)
+    XMLElement* rootElement = doc.RootElement();
+    if (!rootElement) {
+        cerr << "No root element found in model file: " << filename << endl;
+        return false;
+    }
+    
+    // Maps to store vertex indices
+    map<string, int> vertexIndices;
+    int nextIndex = 0;
+    
+    // Process all triangle elements
+    XMLElement* triangleElement = rootElement->FirstChildElement("triangle");
+    int faceCount = 0;
+    
+    while (triangleElement) {
+        XMLElement* vertex1 = triangleElement->FirstChildElement("vertex");
+        XMLElement* vertex2 = vertex1 ? vertex1->NextSiblingElement("vertex") : nullptr;
+        XMLElement* vertex3 = vertex2 ? vertex2->NextSiblingElement("vertex") : nullptr;
+        
+        if (vertex1 && vertex2 && vertex3) {
+            // Create three vertices for the triangle
+            vector<int> vertexIndicesForTriangle;
+            
+            // Process each vertex of the triangle
+            for (XMLElement* vertex : {vertex1, vertex2, vertex3}) {
+                float x = 0, y = 0, z = 0;
+                vertex->QueryFloatAttribute("x", &x);
+                vertex->QueryFloatAttribute("y", &y);
+                vertex->QueryFloatAttribute("z", &z);
+                
+                // Create a unique key for this vertex
+                string vertexKey = to_string(x) + "," + to_string(y) + "," + to_string(z);
+                
+                // Check if we've seen this vertex before
+                if (vertexIndices.find(vertexKey) == vertexIndices.end()) {
+                    // New vertex, add it to the model
+                    modelData.vertices.push_back(Vertex(x, y, z));
+                    vertexIndices[vertexKey] = nextIndex;
+                    vertexIndicesForTriangle.push_back(nextIndex);
+                    nextIndex++;
+                } else {
+                    // Existing vertex, reuse its index
+                    vertexIndicesForTriangle.push_back(vertexIndices[vertexKey]);
+                }
+            }
+            
+            // Add the face if we have three valid vertices
+            if (vertexIndicesForTriangle.size() == 3) {
+                modelData.faces.push_back(Face(
+                    vertexIndicesForTriangle[0],
+                    vertexIndicesForTriangle[1],
+                    vertexIndicesForTriangle[2]
+                ));
+                faceCount++;
+            }
+        } else {
+            cerr << "Triangle missing vertices in model file: " << filename << endl;
+        }
+        
+        triangleElement = triangleElement->NextSiblingElement("triangle");
+    }
+    
+    bakeDrawVertices(modelData);
+    
+    modelData.loaded = true;
+    cout << "Model loaded: " << filename << " (" << modelData.vertices.size() << " vertices, " 
+         << faceCount << " faces)" << endl;
+    
+    return true;
+}
+
+// Model files are parsed by one document per thread (the main thread and the streaming
+// loader), reused from file to file so its node pools keep their blocks. A document
+// left holding more than MODEL_DOCUMENT_KEEP_BYTES after a large model frees them.
+// Model files are generated: they are parsed without line counting or entities.
+static const size_t MODEL_POOL_BLOCK_SIZE = 64 * 1024;
+static const size_t MODEL_DOCUMENT_KEEP_BYTES = 64 << 20;
+
+static XMLDocument& modelDocument() {
+    thread_local XMLDocument doc;
+    thread_local bool configured = false;
+    if (!configured) {
+        doc.SetPoolBlockSize(MODEL_POOL_BLOCK_SIZE);
+        doc.SetParseProfile(MACHINE_GENERATED_PARSE);
+        configured = true;
+    }
+    return doc;
+}
+
+// Drop the nodes (and the buffer they point into) once the model is read
+static void releaseModelDocument(XMLDocument& doc) {
+    doc.Clear();
+    if (doc.PoolStats().blockBytes > MODEL_DOCUMENT_KEEP_BYTES) {
+        doc.ReleasePoolMemory();
+    }
+}
+
+static void reportParseError(const XMLDocument& doc, const string& filename) {
+    cerr << "Error parsing XML in model file: " << filename << " (line " << doc.ErrorLineNum() << ", "
+         << doc.ErrorName() << ")" << endl;
+}
+
+// Load a 3D model from file, parsed in place in a private mapping of it
+bool loadModel(ModelData& modelData, const string& filename) {
+    MappedFile file;
+    if (!file.open(filename)) {
+        cerr << "Error opening model file: " << filename << endl;
+        return false;
+    }
+    
+    XMLDocument& doc = modelDocument();
+    bool loaded = doc.ParseInSitu(file.data(), file.size()) == XML_SUCCESS;
+    if (!loaded) {
+        // The failed parse wrote into the mapping and counted no lines: parse a fresh
+        // mapping of the file again, counting them, to say where the error is
+        doc.Clear();
+        doc.SetParseProfile(STANDARD_PARSE);
+        if (file.open(filename)) doc.ParseInSitu(file.data(), file.size());
+        doc.SetParseProfile(MACHINE_GENERATED_PARSE);
+        reportParseError(doc, filename);
+    } else {
+        loaded = readModel(modelData, filename, doc);
+    }
+    releaseModelDocument(doc);
+    return loaded;
+}
+
+// Load a 3D model from the contents of a .3d file
+bool loadModel(ModelData& modelData, const string& filename, const char* content, size_t size) {
+    // The contents are read only (an asset pack), the parser works on a copy
+    XMLDocument& doc = modelDocument();
+    bool loaded = doc.Parse(content, size) == XML_SUCCESS;
+    if (!loaded) {
+        reportParseError(doc, filename);
+    } else {
+        loaded = readModel(modelData, filename, doc);
+    }
+    releaseModelDocument(doc);
+    return loaded;
+}
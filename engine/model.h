@@ -0,0 +1,55 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// Structure to represent a 3D vertex
+struct Vertex {
+    float x, y, z;
+    
+    Vertex() : x(0), y(0), z(0) {}
+    Vertex(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
+};
+
+// Structure to represent a face (triangle)
+struct Face {
+    int v1, v2, v3;  // Vertex indices
+    
+    Face() : v1(0), v2(0), v3(0) {}
+    Face(int _v1, int _v2, int _v3) : v1(_v1), v2(_v2), v3(_v3) {}
+};
+
+// Vertex as stored in the draw buffer: position and RGBA color attribute
+struct DrawVertex {
+    float x, y, z;
+    unsigned char r, g, b, a;
+};
+
+// Structure to represent a 3D model with vertices and faces
+struct ModelData {
+    std::string filename;
+    std::vector<Vertex> vertices;
+    std::vector<Face> faces;
+    
+    // Three vertices per face with the face color baked in, built at load time
+    std::vector<DrawVertex> drawVertices;
+    unsigned int drawBuffer; // OpenGL buffer holding drawVertices (0 until uploaded)
+    unsigned int firstVertex; // Where drawVertices start in drawBuffer (shared by all models in core profile)
+    
+    // Axis-aligned bounding box of the vertices
+    float boundsMin[3], boundsMax[3];
+    
+    bool loaded;
+    
+    ModelData() : drawBuffer(0), firstVertex(0), boundsMin{0, 0, 0}, boundsMax{0, 0, 0}, loaded(false) {}
+    
+    size_t triangleCount() const { return drawVertices.size() / 3; }
+};
+
+// Load a 3D model from a .3d file
+bool loadModel(ModelData& modelData, const std::string& filename);
+
+// Load a 3D model from the contents of a .3d file already in memory (e.g. an asset pack)
+bool loadModel(ModelData& modelData, const std::string& filename, const char* content, size_t size);
+
+// Build the draw buffer and bounding box from the vertices and faces
+void bakeDrawVertices(ModelData& modelData);
@@ -0,0 +1,282 @@
+#include "occlusion.h"
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+OcclusionCuller::OcclusionCuller(ThreadPool& threadPool) : pool(threadPool) {
+    // Levels halve in size down to 1x1
+    int w = WIDTH, h = HEIGHT;
+    while (true) {
+        levelWidth.push_back(w);
+        levelHeight.push_back(h);
+        pyramid.push_back(vector<float>((size_t) w * h, 1.0f));
+        if (w == 1 && h == 1) break;
+        w = max(1, w / 2);
+        h = max(1, h / 2);
+    }
+}
+
+OcclusionCuller::BoxResult OcclusionCuller::projectBox(const float boundsMin[3], const float boundsMax[3],
+                                                       ScreenRect& rect) const {
+    float clip[8][4];
+    for (int i = 0; i < 8; i++) {
+        viewProj.transformPoint(i & 1 ? boundsMax[0] : boundsMin[0],
+                                i & 2 ? boundsMax[1] : boundsMin[1],
+                                i & 4 ? boundsMax[2] : boundsMin[2], clip[i]);
+    }
+
+    // Outside if all corners are beyond the same frustum plane
+    for (int axis = 0; axis < 3; axis++) {
+        bool allBelow = true, allAbove = true;
+        for (int i = 0; i < 8; i++) {
+            if (clip[i][axis] >= -clip[i][3]) allBelow = false;
+            if (clip[i][axis] <= clip[i][3]) allAbove = false;
+        }
+        if (allBelow || allAbove) return BOX_OUTSIDE;
+    }
+
+    // A box crossing the near plane has no meaningful screen rectangle
+    for (int i = 0; i < 8; i++) {
+        if (clip[i][2] < -clip[i][3]) return BOX_CROSSES_NEAR;
+    }
+
+    rect.minX = rect.minY = rect.minZ = 1e30f;
+    rect.maxX = rect.maxY = -1e30f;
+    for (int i = 0; i < 8; i++) {
+        float invW = 1.0f / clip[i][3];
+        float x = (clip[i][0] * invW * 0.5f + 0.5f) * WIDTH;
+        float y = (0.5f - clip[i][1] * invW * 0.5f) * HEIGHT;
+        float z = clip[i][2] * invW * 0.5f + 0.5f;
+        rect.minX = min(rect.minX, x);
+        rect.maxX = max(rect.maxX, x);
+        rect.minY = min(rect.minY, y);
+        rect.maxY = max(rect.maxY, y);
+        rect.minZ = min(rect.minZ, z);
+    }
+    return BOX_ON_SCREEN;
+}
+
+void OcclusionCuller::prepare(const Mat4& matrix, const vector<InstanceRef>& candidates) {
+    auto start = chrono::steady_clock::now();
+
+    viewProj = matrix;
+    stats = OcclusionStats();
+    triangles.clear();
+
+    // Pick the instances covering the most screen area as occluders
+    vector<pair<float, const InstanceRef*>> scored;
+    for (const InstanceRef& instance : candidates) {
+        if (instance.model->triangleCount() > (size_t) MAX_OCCLUDER_TRIANGLES) continue;
+
+        ScreenRect rect;
+        if (projectBox(instance.bounds->min, instance.bounds->max, rect) != BOX_ON_SCREEN) continue;
+
+        float w = min(rect.maxX, (float) WIDTH) - max(rect.minX, 0.0f);
+        float h = min(rect.maxY, (float) HEIGHT) - max(rect.minY, 0.0f);
+        float area = max(w, 0.0f) * max(h, 0.0f) / (WIDTH * HEIGHT);
+        if (area >= MIN_OCCLUDER_AREA) scored.push_back(make_pair(area, &instance));
+    }
+
+    size_t count = min(scored.size(), (size_t) MAX_OCCLUDERS);
+    partial_sort(scored.begin(), scored.begin() + count, scored.end(),
+                 [](const pair<float, const InstanceRef*>& a, const pair<float, const InstanceRef*>& b) {
+                     return a.first > b.first;
+                 });
+
+    for (size_t i = 0; i < count; i++) {
+        setupOccluder(*scored[i].second);
+        stats.occluders++;
+        stats.occluderTriangles += scored[i].second->model->triangleCount();
+    }
+
+    // Each task rasterizes all occluder triangles into its own band of rows
+    pool.parallelFor(HEIGHT / BAND_HEIGHT, [this](int band, int) {
+        rasterizeBand(band);
+    });
+
+    buildPyramid();
+
+    stats.prepareMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+void OcclusionCuller::setupOccluder(const InstanceRef& instance) {
+    const ModelData& model = *instance.model;
+    Mat4 modelViewProj = viewProj * *instance.world;
+
+    vector<float> clip(model.vertices.size() * 4);
+    for (size_t i = 0; i < model.vertices.size(); i++) {
+        const Vertex& v = model.vertices[i];
+        modelViewProj.transformPoint(v.x, v.y, v.z, &clip[i * 4]);
+    }
+
+    for (const Face& face : model.faces) {
+        const int index[3] = {face.v1, face.v2, face.v3};
+        float v[3][3];
+        bool usable = true;
+
+        for (int k = 0; k < 3 && usable; k++) {
+            const float* c = &clip[index[k] * 4];
+            // Triangles crossing the near plane are skipped, dropping occluders is always safe
+            if (c[2] < -c[3]) {
+                usable = false;
+                break;
+            }
+            float invW = 1.0f / c[3];
+            v[k][0] = (c[0] * invW * 0.5f + 0.5f) * WIDTH;
+            v[k][1] = (0.5f - c[1] * invW * 0.5f) * HEIGHT;
+            v[k][2] = c[2] * invW * 0.5f + 0.5f;
+        }
+        if (!usable) continue;
+
+        float area = (v[1][0] - v[0][0]) * (v[2][1] - v[0][1]) - (v[2][0] - v[0][0]) * (v[1][1] - v[0][1]);
+        if (area == 0.0f) continue;
+
+        float minX = min({v[0][0], v[1][0], v[2][0]}), maxX = max({v[0][0], v[1][0], v[2][0]});
+        float minY = min({v[0][1], v[1][1], v[2][1]}), maxY = max({v[0][1], v[1][1], v[2][1]});
+        if (maxX < 0.0f || maxY < 0.0f || minX >= WIDTH || minY >= HEIGHT) continue;
+
+        DepthTriangle t;
+        t.minX = (int) max(minX, 0.0f);
+        t.minY = (int) max(minY, 0.0f);
+        t.maxX = (int) min(maxX, (float) (WIDTH - 1));
+        t.maxY = (int) min(maxY, (float) (HEIGHT - 1));
+
+        float sign = area > 0 ? 1.0f : -1.0f;
+        for (int e = 0; e < 3; e++) {
+            const float* a = v[(e + 1) % 3];
+            const float* b = v[(e + 2) % 3];
+            t.edgeA[e] = sign * (a[1] - b[1]);
+            t.edgeB[e] = sign * (b[0] - a[0]);
+            t.edgeC[e] = sign * (a[0] * b[1] - b[0] * a[1]);
+        }
+
+        float invArea = sign / area;
+        t.depthA = (v[0][2] * t.edgeA[0] + v[1][2] * t.edgeA[1] + v[2][2] * t.edgeA[2]) * invArea;
+        t.depthB = (v[0][2] * t.edgeB[0] + v[1][2] * t.edgeB[1] + v[2][2] * t.edgeB[2]) * invArea;
+        t.depthC = (v[0][2] * t.edgeC[0] + v[1][2] * t.edgeC[1] + v[2][2] * t.edgeC[2]) * invArea;
+        triangles.push_back(t);
+    }
+}
+
+void OcclusionCuller::rasterizeBand(int band) {
+    vector<float>& depth = pyramid[0];
+    int bandY0 = band * BAND_HEIGHT;
+    int bandY1 = bandY0 + BAND_HEIGHT - 1;
+
+    fill(depth.begin() + (size_t) bandY0 * WIDTH, depth.begin() + (size_t) (bandY1 + 1) * WIDTH, 1.0f);
+
+    for (const DepthTriangle& t : triangles) {
+        int y0 = max(t.minY, bandY0);
+        int y1 = min(t.maxY, bandY1);
+        if (y0 > y1) continue;
+
+        int x0 = t.minX & ~3;
+        int x1 = t.maxX;
+
+#ifdef __SSE2__
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+        const __m128 a0 = _mm_set1_ps(t.edgeA[0]), a1 = _mm_set1_ps(t.edgeA[1]), a2 = _mm_set1_ps(t.edgeA[2]);
+        const __m128 depthA = _mm_set1_ps(t.depthA);
+
+        for (int y = y0; y <= y1; y++) {
+            float py = y + 0.5f;
+            __m128 row0 = _mm_set1_ps(t.edgeB[0] * py + t.edgeC[0]);
+            __m128 row1 = _mm_set1_ps(t.edgeB[1] * py + t.edgeC[1]);
+            __m128 row2 = _mm_set1_ps(t.edgeB[2] * py + t.edgeC[2]);
+            __m128 depthRow = _mm_set1_ps(t.depthB * py + t.depthC);
+
+            for (int x = x0; x <= x1; x += 4) {
+                __m128 px = _mm_add_ps(_mm_set1_ps((float) x), offsets);
+                __m128 inside = _mm_and_ps(
+                    _mm_and_ps(_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a0, px), row0), zero),
+                               _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a1, px), row1), zero)),
+                    _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a2, px), row2), zero));
+                if (_mm_movemask_ps(inside) == 0) continue;
+
+                float* ptr = &depth[(size_t) y * WIDTH + x];
+                __m128 oldZ = _mm_loadu_ps(ptr);
+                __m128 z = _mm_min_ps(_mm_add_ps(_mm_mul_ps(depthA, px), depthRow), oldZ);
+                _mm_storeu_ps(ptr, _mm_or_ps(_mm_and_ps(inside, z), _mm_andnot_ps(inside, oldZ)));
+            }
+        }
+#else
+        for (int y = y0; y <= y1; y++) {
+            float py = y + 0.5f;
+            for (int x = x0; x <= x1; x++) {
+                float px = x + 0.5f;
+                if (t.edgeA[0] * px + t.edgeB[0] * py + t.edgeC[0] < 0) continue;
+                if (t.edgeA[1] * px + t.edgeB[1] * py + t.edgeC[1] < 0) continue;
+                if (t.edgeA[2] * px + t.edgeB[2] * py + t.edgeC[2] < 0) continue;
+
+                float z = t.depthA * px + t.depthB * py + t.depthC;
+                float& d = depth[(size_t) y * WIDTH + x];
+                if (z < d) d = z;
+            }
+        }
+#endif
+    }
+}
+
+// Every texel of a level keeps the farthest depth of the 2x2 texels below it
+void OcclusionCuller::buildPyramid() {
+    for (size_t level = 1; level < pyramid.size(); level++) {
+        const vector<float>& src = pyramid[level - 1];
+        vector<float>& dst = pyramid[level];
+        int srcW = levelWidth[level - 1], srcH = levelHeight[level - 1];
+        int w = levelWidth[level], h = levelHeight[level];
+
+        for (int y = 0; y < h; y++) {
+            int sy0 = min(y * 2, srcH - 1), sy1 = min(y * 2 + 1, srcH - 1);
+            for (int x = 0; x < w; x++) {
+                int sx0 = min(x * 2, srcW - 1), sx1 = min(x * 2 + 1, srcW - 1);
+                dst[(size_t) y * w + x] = max(max(src[(size_t) sy0 * srcW + sx0], src[(size_t) sy0 * srcW + sx1]),
+                                              max(src[(size_t) sy1 * srcW + sx0], src[(size_t) sy1 * srcW + sx1]));
+            }
+        }
+    }
+}
+
+bool OcclusionCuller::isVisible(const float boundsMin[3], const float boundsMax[3]) {
+    stats.tested++;
+
+    ScreenRect rect;
+    BoxResult result = projectBox(boundsMin, boundsMax, rect);
+    if (result == BOX_OUTSIDE) {
+        stats.frustumCulled++;
+        return false;
+    }
+    if (result == BOX_CROSSES_NEAR || triangles.empty()) return true;
+
+    int x0 = max(0, (int) floorf(rect.minX));
+    int y0 = max(0, (int) floorf(rect.minY));
+    int x1 = min(WIDTH - 1, (int) ceilf(rect.maxX) - 1);
+    int y1 = min(HEIGHT - 1, (int) ceilf(rect.maxY) - 1);
+    if (x0 > x1 || y0 > y1) return true;
+
+    // Coarsest level where the rectangle covers at most 4x4 texels, coarser
+    // levels would mostly compare against depth from around the rectangle
+    size_t level = 0;
+    while (level + 1 < pyramid.size() && ((x1 >> level) - (x0 >> level) > 3 || (y1 >> level) - (y0 >> level) > 3)) {
+        level++;
+    }
+
+    int w = levelWidth[level];
+    float farthest = 0.0f;
+    for (int y = y0 >> level; y <= (y1 >> level); y++) {
+        for (int x = x0 >> level; x <= (x1 >> level); x++) {
+            farthest = max(farthest, pyramid[level][(size_t) y * w + x]);
+        }
+    }
+
+    if (rect.minZ > farthest) {
+        stats.occluded++;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <vector>
+#include "matrix.h"
+#include "model.h"
+#include "scene.h"
+#include "threadpool.h"
+
+// Counters of the last culling pass
+struct OcclusionStats {
+    int tested;            // Bounding boxes tested
+    int frustumCulled;     // Boxes entirely outside the view frustum
+    int occluded;          // Boxes hidden behind the occluders
+    int occluders;         // Instances rasterized into the depth buffer
+    long occluderTriangles;
+    double prepareMs;      // Occluder selection, rasterization and pyramid build
+
+    OcclusionStats() : tested(0), frustumCulled(0), occluded(0), occluders(0), occluderTriangles(0),
+                       prepareMs(0) {}
+};
+
+// CPU occlusion culler: the largest on-screen models are rasterized into a
+// low-resolution depth buffer, a max-depth pyramid is built from it and
+// bounding boxes are tested against the pyramid before they are drawn
+class OcclusionCuller {
+public:
+    static const int WIDTH = 256;
+    static const int HEIGHT = 128;
+    static const int BAND_HEIGHT = 16;              // Rows rasterized per task
+    static const int MAX_OCCLUDERS = 32;
+    static const int MAX_OCCLUDER_TRIANGLES = 16384; // Larger meshes are too costly as occluders
+    static constexpr float MIN_OCCLUDER_AREA = 0.01f; // Fraction of the screen
+
+    explicit OcclusionCuller(ThreadPool& pool);
+
+    // Select and rasterize occluders among the candidates, then build the pyramid
+    void prepare(const Mat4& viewProj, const std::vector<InstanceRef>& candidates);
+
+    // False if the box is outside the frustum or hidden behind the occluders
+    bool isVisible(const float boundsMin[3], const float boundsMax[3]);
+
+    const OcclusionStats& getStats() const { return stats; }
+
+private:
+    // Screen-space bounds of a box, in depth buffer pixels
+    struct ScreenRect {
+        float minX, minY, maxX, maxY;
+        float minZ;
+    };
+
+    // Triangle prepared for depth rasterization
+    struct DepthTriangle {
+        float edgeA[3], edgeB[3], edgeC[3];
+        float depthA, depthB, depthC;
+        int minX, minY, maxX, maxY;
+    };
+
+    enum BoxResult { BOX_OUTSIDE, BOX_CROSSES_NEAR, BOX_ON_SCREEN };
+    BoxResult projectBox(const float boundsMin[3], const float boundsMax[3], ScreenRect& rect) const;
+
+    void setupOccluder(const InstanceRef& instance);
+    void rasterizeBand(int band);
+    void buildPyramid();
+
+    ThreadPool& pool;
+    Mat4 viewProj;
+
+    std::vector<DepthTriangle> triangles;
+    std::vector<std::vector<float>> pyramid; // Level 0 is the depth buffer, each level keeps the farthest depth
+    std::vector<int> levelWidth, levelHeight;
+
+    OcclusionStats stats;
+};
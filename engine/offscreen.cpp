@@ -0,0 +1,250 @@
+#define GL_GLEXT_PROTOTYPES
+#include "offscreen.h"
+#include "image.h"
+#include "options.h"
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+OffscreenRenderer::OffscreenRenderer(GLStateCache& state)
+    : state(state), width(0), height(0), display(EGL_NO_DISPLAY), context(EGL_NO_CONTEXT),
+      framebuffer(0), colorBuffer(0), depthBuffer(0), nextPbo(0), stopping(false) {
+    for (int i = 0; i < PBO_COUNT; i++) {
+        pbos[i] = 0;
+        fences[i] = nullptr;
+    }
+}
+
+OffscreenRenderer::~OffscreenRenderer() {
+    finish();
+    destroy();
+}
+
+bool OffscreenRenderer::init(int w, int h, bool coreProfile) {
+    width = w;
+    height = h;
+
+    // Prefer the surfaceless platform, it needs neither a window system nor a GPU
+    EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay) {
+        eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if (eglDisplay == EGL_NO_DISPLAY) {
+        eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+
+    EGLint major, minor;
+    if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, &major, &minor)) {
+        cerr << "Error initializing EGL display" << endl;
+        return false;
+    }
+    display = eglDisplay;
+
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        cerr << "EGL implementation does not support desktop OpenGL" << endl;
+        return false;
+    }
+
+    // No config is needed because nothing is drawn to an EGL surface
+    EGLConfig config = EGL_NO_CONFIG_KHR;
+    const char* extensions = eglQueryString(eglDisplay, EGL_EXTENSIONS);
+    if (!extensions || !strstr(extensions, "EGL_KHR_no_config_context")) {
+        const EGLint configAttribs[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+        EGLint configCount = 0;
+        if (!eglChooseConfig(eglDisplay, configAttribs, &config, 1, &configCount) || configCount == 0) {
+            cerr << "No suitable EGL config found" << endl;
+            return false;
+        }
+    }
+
+    // The fixed-function path needs a compatibility context
+    const EGLint coreAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLContext eglContext = eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT, coreProfile ? coreAttribs : nullptr);
+    if (eglContext == EGL_NO_CONTEXT) {
+        cerr << "Error creating EGL context (0x" << hex << eglGetError() << dec << ")" << endl;
+        return false;
+    }
+    context = eglContext;
+
+    if (!eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, eglContext)) {
+        cerr << "Error making the EGL context current" << endl;
+        return false;
+    }
+
+    state.invalidate();
+    cout << "Offscreen renderer: " << glGetString(GL_RENDERER) << " (" << glGetString(GL_VERSION) << ")" << endl;
+
+    // Framebuffer with color and depth renderbuffers
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        cerr << "Offscreen framebuffer is incomplete" << endl;
+        return false;
+    }
+
+    glDrawBuffer(GL_COLOR_ATTACHMENT0);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+
+    // Pixel buffer objects for asynchronous readback
+    glGenBuffers(PBO_COUNT, pbos);
+    for (int i = 0; i < PBO_COUNT; i++) {
+        state.bindBuffer(GL_PIXEL_PACK_BUFFER, pbos[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr) width * height * 3, nullptr, GL_STREAM_READ);
+    }
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+    stopping = false;
+    writer = thread(&OffscreenRenderer::writerLoop, this);
+    return true;
+}
+
+void OffscreenRenderer::endFrame(const string& filename) {
+    int slot = nextPbo;
+    nextPbo = (nextPbo + 1) % PBO_COUNT;
+
+    // The slot still holds a frame from PBO_COUNT frames ago, hand it to the writer first
+    if (fences[slot]) {
+        collectReadback(slot);
+    }
+
+    // Queue the copy into the PBO, glReadPixels returns without waiting for the GPU
+    // Only readbacks use the pack buffer binding, so it is left bound between frames
+    state.bindBuffer(GL_PIXEL_PACK_BUFFER, pbos[slot]);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+
+    fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    pboFilenames[slot] = filename;
+}
+
+void OffscreenRenderer::collectReadback(int slot) {
+    GLsync fence = (GLsync) fences[slot];
+    glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    glDeleteSync(fence);
+    fences[slot] = nullptr;
+
+    PendingWrite write;
+    write.filename = pboFilenames[slot];
+    write.pixels.resize((size_t) width * height * 3);
+
+    state.bindBuffer(GL_PIXEL_PACK_BUFFER, pbos[slot]);
+    const void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, write.pixels.size(), GL_MAP_READ_BIT);
+    if (data) {
+        memcpy(write.pixels.data(), data, write.pixels.size());
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+
+    // Block only if the disk cannot keep up with rendering
+    unique_lock<mutex> lock(queueMutex);
+    queueChanged.wait(lock, [this] { return (int) queue.size() < MAX_PENDING_WRITES; });
+    queue.push_back(move(write));
+    queueChanged.notify_all();
+}
+
+void OffscreenRenderer::writerLoop() {
+    vector<unsigned char> flipped;
+    while (true) {
+        PendingWrite write;
+        {
+            unique_lock<mutex> lock(queueMutex);
+            queueChanged.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (queue.empty()) return;
+            write = move(queue.front());
+            queue.pop_front();
+        }
+        queueChanged.notify_all();
+
+        // OpenGL returns rows bottom to top
+        size_t rowSize = (size_t) width * 3;
+        flipped.resize(write.pixels.size());
+        for (int y = 0; y < height; y++) {
+            memcpy(&flipped[y * rowSize], &write.pixels[(height - 1 - y) * rowSize], rowSize);
+        }
+
+        if (!writeImage(write.filename, width, height, flipped.data())) {
+            cerr << "Error writing image: " << write.filename << endl;
+        }
+    }
+}
+
+void OffscreenRenderer::finish() {
+    if (context == EGL_NO_CONTEXT) return;
+
+    // Collect the remaining readbacks in frame order
+    for (int i = 0; i < PBO_COUNT; i++) {
+        int slot = (nextPbo + i) % PBO_COUNT;
+        if (fences[slot]) collectReadback(slot);
+    }
+
+    if (writer.joinable()) {
+        {
+            lock_guard<mutex> lock(queueMutex);
+            stopping = true;
+        }
+        queueChanged.notify_all();
+        writer.join();
+    }
+}
+
+void OffscreenRenderer::destroy() {
+    if (context == EGL_NO_CONTEXT) {
+        if (display != EGL_NO_DISPLAY) eglTerminate((EGLDisplay) display);
+        display = EGL_NO_DISPLAY;
+        return;
+    }
+
+    glDeleteBuffers(PBO_COUNT, pbos);
+    glDeleteRenderbuffers(1, &colorBuffer);
+    glDeleteRenderbuffers(1, &depthBuffer);
+    glDeleteFramebuffers(1, &framebuffer);
+
+    eglMakeCurrent((EGLDisplay) display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext((EGLDisplay) display, (EGLContext) context);
+    eglTerminate((EGLDisplay) display);
+    context = EGL_NO_CONTEXT;
+    display = EGL_NO_DISPLAY;
+}
+
+string frameFilename(const string& pattern, int frameNumber, int frameCount) {
+    // The pattern was checked with the options; only the frame number is formatted
+    FramePattern field;
+    if (!parseFramePattern(pattern, field)) return pattern;
+
+    char number[32];
+    if (field.hasField) {
+        snprintf(number, sizeof(number), "%0*d", field.width, frameNumber);
+        return field.prefix + number + field.suffix;
+    }
+
+    // A single frame keeps the name as given
+    const string& name = field.prefix;
+    if (frameCount <= 1) return name;
+
+    snprintf(number, sizeof(number), "_%04d", frameNumber);
+    size_t dot = name.rfind('.');
+    if (dot == string::npos) return name + number;
+    return name.substr(0, dot) + number + name.substr(dot);
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "glstate.h"
+
+// Windowless OpenGL context (Mesa surfaceless EGL) rendering into a framebuffer object.
+// Frames are read back asynchronously through a ring of pixel buffer objects and
+// written to disk by a separate thread, so disk writes overlap rendering.
+class OffscreenRenderer {
+public:
+    // Number of pixel buffer objects in flight
+    static const int PBO_COUNT = 3;
+
+    // Maximum number of frames waiting for the writer thread
+    static const int MAX_PENDING_WRITES = 8;
+
+    // Buffer binds go through the engine's state cache, which is reset when the context is created
+    explicit OffscreenRenderer(GLStateCache& state);
+    ~OffscreenRenderer();
+
+    // Create the context and framebuffer, and make them current.
+    // The context is a 3.3 core profile one if requested, a compatibility one otherwise.
+    bool init(int width, int height, bool coreProfile);
+
+    // Start the readback of the frame just rendered into the framebuffer,
+    // the image is written to filename once the pixels arrive
+    void endFrame(const std::string& filename);
+
+    // Wait for all readbacks and disk writes
+    void finish();
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+private:
+    struct PendingWrite {
+        std::string filename;
+        std::vector<unsigned char> pixels; // Bottom-up rows, as returned by OpenGL
+    };
+
+    void collectReadback(int slot);
+    void writerLoop();
+    void destroy();
+
+    GLStateCache& state;
+    int width, height;
+
+    void* display; // EGLDisplay
+    void* context; // EGLContext
+    unsigned int framebuffer, colorBuffer, depthBuffer;
+
+    unsigned int pbos[PBO_COUNT];
+    void* fences[PBO_COUNT];           // GLsync of the readback in each PBO
+    std::string pboFilenames[PBO_COUNT];
+    int nextPbo;
+
+    std::thread writer;
+    std::mutex queueMutex;
+    std::condition_variable queueChanged;
+    std::deque<PendingWrite> queue;
+    bool stopping;
+};
+
+// Build the image filename of a frame from a pattern with an optional %d / %0Nd field.
+// Without one, the frame number is inserted before the extension.
+std::string frameFilename(const std::string& pattern, int frameNumber, int frameCount);
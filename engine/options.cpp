@@ -0,0 +1,205 @@
+#include "options.h"
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+bool parseFramePattern(const string& pattern, FramePattern& result) {
+    result = FramePattern();
+    string* text = &result.prefix;
+    for (size_t i = 0; i < pattern.size(); i++) {
+        if (pattern[i] != '%') {
+            *text += pattern[i];
+            continue;
+        }
+        if (i + 1 < pattern.size() && pattern[i + 1] == '%') {
+            *text += '%';
+            i++;
+            continue;
+        }
+
+        // %d or %0Nd, N of one or two digits
+        size_t end = i + 1;
+        int width = 0;
+        if (end < pattern.size() && pattern[end] == '0') {
+            end++;
+            size_t digits = end;
+            while (end < pattern.size() && isdigit((unsigned char) pattern[end]) && end - digits < 2) {
+                width = width * 10 + (pattern[end++] - '0');
+            }
+            if (end == digits) return false;
+        }
+        if (end >= pattern.size() || pattern[end] != 'd' || result.hasField) return false;
+
+        result.hasField = true;
+        result.width = width;
+        text = &result.suffix;
+        i = end;
+    }
+    return true;
+}
+
+bool parseOptions(int argc, char** argv, EngineOptions& options) {
+    bool streamMargin = false;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--bench") {
+            options.bench.enabled = true;
+            // Consume the key=value options that follow
+            while (i + 1 < argc && argv[i + 1][0] != '-' && strchr(argv[i + 1], '=')) {
+                if (!options.bench.parseOption(argv[++i])) {
+                    cerr << "Invalid benchmark option: " << argv[i] << endl;
+                    return false;
+                }
+            }
+        } else if (arg == "--play" && hasValue) {
+            options.bench.enabled = true;
+            options.bench.pathFile = argv[++i];
+        } else if (arg == "--realtime") {
+            options.bench.realtime = true;
+        } else if (arg == "--record" && hasValue) {
+            options.recordFile = argv[++i];
+        } else if (arg == "--compile" && i + 2 < argc) {
+            options.configFile = argv[++i];
+            options.compileFile = argv[++i];
+        } else if (arg == "--search-path" && hasValue) {
+            options.searchPaths.push_back(argv[++i]);
+        } else if ((arg == "--cpu-budget" || arg == "--gpu-budget") && hasValue) {
+            int megabytes = atoi(argv[++i]);
+            if (megabytes < 0) {
+                cerr << "Invalid memory budget: " << argv[i] << endl;
+                return false;
+            }
+            (arg == "--cpu-budget" ? options.cpuBudgetMB : options.gpuBudgetMB) = megabytes;
+        } else if (arg == "--stream" && hasValue) {
+            options.streaming.radius = atof(argv[++i]);
+            if (options.streaming.radius <= 0.0f) {
+                cerr << "Invalid streaming radius: " << argv[i] << endl;
+                return false;
+            }
+        } else if (arg == "--stream-margin" && hasValue) {
+            options.streaming.margin = atof(argv[++i]);
+            streamMargin = true;
+            if (options.streaming.margin < 0.0f) {
+                cerr << "Invalid streaming margin: " << argv[i] << endl;
+                return false;
+            }
+        } else if (arg == "--upload-budget" && hasValue) {
+            int kilobytes = atoi(argv[++i]);
+            if (kilobytes <= 0) {
+                cerr << "Invalid upload budget: " << argv[i] << endl;
+                return false;
+            }
+            options.streaming.uploadBudget = (size_t) kilobytes << 10;
+        } else if (arg == "--backend" && hasValue) {
+            string backend = argv[++i];
+            if (backend == "gl") {
+                options.backend = BACKEND_GL;
+            } else if (backend == "soft") {
+                options.backend = BACKEND_SOFTWARE;
+            } else if (backend == "offscreen") {
+                options.backend = BACKEND_OFFSCREEN;
+            } else {
+                cerr << "Unknown backend: " << backend << endl;
+                return false;
+            }
+        } else if (arg == "--output" && hasValue) {
+            options.outputFile = argv[++i];
+            FramePattern pattern;
+            if (!parseFramePattern(options.outputFile, pattern)) {
+                cerr << "Invalid output file name: " << argv[i] << " (use one %d or %0Nd for the frame number, %% for %)"
+                     << endl;
+                printUsage(argv[0]);
+                return false;
+            }
+        } else if (arg == "--threads" && hasValue) {
+            options.threads = atoi(argv[++i]);
+            if (options.threads < 0) {
+                cerr << "Invalid thread count: " << argv[i] << endl;
+                return false;
+            }
+        } else if (arg == "--frames" && hasValue) {
+            options.frames = atoi(argv[++i]);
+            if (options.frames <= 0) {
+                cerr << "Invalid frame count: " << argv[i] << endl;
+                return false;
+            }
+        } else if (arg == "--orbit" && hasValue) {
+            char* end;
+            options.orbitDegrees = strtof(argv[++i], &end);
+            if (end == argv[i] || *end != '\0' || !isfinite(options.orbitDegrees)) {
+                cerr << "Invalid orbit angle: " << argv[i] << endl;
+                return false;
+            }
+        } else if (arg == "--stats" && hasValue) {
+            options.statsInterval = atoi(argv[++i]);
+            if (options.statsInterval <= 0) {
+                cerr << "Invalid statistics interval: " << argv[i] << endl;
+                return false;
+            }
+        } else if (arg == "--stats-csv" && hasValue) {
+            options.statsFile = argv[++i];
+            if (options.statsInterval == 0) options.statsInterval = 1;
+        } else if (arg == "--core") {
+            options.coreProfile = true;
+        } else if (arg == "--no-pipeline") {
+            options.pipelined = false;
+        } else if (arg[0] != '-') {
+            options.configFile = arg;
+        } else {
+            cerr << "Unknown option: " << arg << endl;
+            return false;
+        }
+    }
+
+    // Models stay loaded a tenth of the radius beyond it by default
+    if (!streamMargin) {
+        options.streaming.margin = options.streaming.radius * 0.1f;
+    }
+
+    // The software backend renders one image from the whole scene
+    if (options.streaming.enabled() && options.backend == BACKEND_SOFTWARE) {
+        cerr << "--stream needs the gl or offscreen backend" << endl;
+        return false;
+    }
+
+    // Check if config file is provided
+    if (options.configFile.empty()) {
+        printUsage(argv[0]);
+        return false;
+    }
+    return true;
+}
+
+void printUsage(const char* program) {
+    cerr << "Usage: " << program << " [options] <config.xml | config.scn | world.pack>" << endl;
+    cerr << "       " << program << " --compile <config.xml> <config.scn>" << endl;
+    cerr << "  --backend gl|soft|offscreen" << endl;
+    cerr << "                          Render in a window (default), on the CPU or to files without a window" << endl;
+    cerr << "  --output FILE           Image written by the soft/offscreen backends (.ppm or .png," << endl;
+    cerr << "                          %d or %0Nd in the name is replaced by the frame number, %% is a %)" << endl;
+    cerr << "  --frames N              Frames rendered by the offscreen backend" << endl;
+    cerr << "  --orbit DEG             Offscreen camera path: rotation around the lookAt point per frame" << endl;
+    cerr << "  --threads N             Worker threads for the soft backend and culling (0 = all cores)" << endl;
+    cerr << "  --core                  Use the OpenGL 3.3 core-profile shader path (gl/offscreen backends)" << endl;
+    cerr << "  --no-pipeline           Prepare each frame on the main thread instead of one frame ahead" << endl;
+    cerr << "  --stats N               Print the render statistics every N frames" << endl;
+    cerr << "  --stats-csv FILE        Write the statistics dump to a CSV file instead (every frame by default)" << endl;
+    cerr << "  --bench frames=N orbit=DEG warmup=N csv=FILE" << endl;
+    cerr << "                          Render N frames orbiting the camera and report frame times" << endl;
+    cerr << "  --record FILE           Record the camera path of the session to FILE" << endl;
+    cerr << "  --play FILE             Benchmark a recorded camera path, one frame per key" << endl;
+    cerr << "  --realtime              With --play, follow the path at its recorded speed" << endl;
+    cerr << "  --search-path DIR       Look for model files in DIR before files3d (repeatable)" << endl;
+    cerr << "  --cpu-budget MB         Evict unused models while their memory exceeds MB (0 = no limit)" << endl;
+    cerr << "  --gpu-budget MB         The same for the draw buffers on the GPU" << endl;
+    cerr << "  --stream RADIUS         Load models in the background as the camera comes within RADIUS" << endl;
+    cerr << "                          (gl/offscreen backends)" << endl;
+    cerr << "  --stream-margin M       ...and unload them beyond RADIUS + M (default RADIUS / 10)" << endl;
+    cerr << "  --upload-budget KB      Streamed model data sent to the GPU per frame (default 1024)" << endl;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "benchmark.h"
+#include "streaming.h"
+
+// Rendering backends selectable at startup
+enum RenderBackend {
+    BACKEND_GL,       // OpenGL window through GLUT
+    BACKEND_SOFTWARE, // Multi-threaded CPU rasterizer, writes an image file
+    BACKEND_OFFSCREEN // OpenGL without a window (surfaceless EGL), writes image files
+};
+
+// Command line options of the engine
+struct EngineOptions {
+    std::string configFile;
+    BenchmarkConfig bench;
+
+    RenderBackend backend;
+    std::string outputFile; // Image written by the soft and offscreen backends
+    int threads;            // Worker threads (0 = one per hardware thread)
+
+    int frames;             // Frames rendered by the offscreen backend
+    float orbitDegrees;     // Camera path of the offscreen backend: rotation per frame
+
+    bool pipelined;         // Prepare the next frame on a worker thread while the current one is submitted
+    bool coreProfile;       // Render with GLSL shaders in an OpenGL 3.3 core-profile context
+
+    int statsInterval;      // Dump the render statistics every N frames (0 = never)
+    std::string statsFile;  // CSV file for the dump (stdout if empty)
+
+    std::string recordFile; // Camera path recorded during the session (--record)
+    std::string compileFile; // Write the compiled scene of configFile here and exit (--compile)
+
+    std::vector<std::string> searchPaths; // Directories searched for model files before files3d
+    size_t cpuBudgetMB;     // Memory budget of the loaded models (0 = no limit)
+    size_t gpuBudgetMB;
+    StreamingConfig streaming; // Load the models near the camera only (--stream)
+
+    EngineOptions() : backend(BACKEND_GL), outputFile("frame.ppm"), threads(0), frames(1), orbitDegrees(0.0f),
+                      pipelined(true), coreProfile(false),
+                      statsInterval(0), cpuBudgetMB(0), gpuBudgetMB(0) {}
+};
+
+// Frame number field of an --output pattern: a single %d or %0Nd, with %% for a percent sign
+struct FramePattern {
+    std::string prefix; // Text before the field (or all of it without one), %% turned into %
+    std::string suffix; // Text after the field
+    int width;          // Zero padded width of the number, 0 for none
+    bool hasField;
+
+    FramePattern() : width(0), hasField(false) {}
+};
+
+// False if the pattern has more than one field or any other % conversion
+bool parseFramePattern(const std::string& pattern, FramePattern& result);
+
+// Parse argv into options, returns false (after printing the error) on invalid input
+bool parseOptions(int argc, char** argv, EngineOptions& options);
+
+void printUsage(const char* program);
@@ -1,12 +1,15 @@
 #include "parser.h"
 #include <iostream>
+#include "mappedfile.h"
 
 using namespace std;
 using namespace tinyxml2;
 
-bool SimpleParser::parseXMLFile(const std::string& filename, Window& window, Camera& camera, Group& group) {
+bool SimpleParser::parseXMLFile(const std::string& filename, Window& window, Camera& camera, Scene& scene) {
+    // Parsed in place in a private mapping of the file, which must outlive the document
+    MappedFile file;
     XMLDocument doc;
-    if (doc.LoadFile(filename.c_str()) != XML_SUCCESS) {
+    if (!file.open(filename) || doc.ParseInSitu(file.data(), file.size()) != XML_SUCCESS) {
         cerr << "Error loading XML file: " << filename << endl;
         return false;
     }
@@ -65,29 +68,110 @@ bool SimpleParser::parseXMLFile(const std::string& filename, Window& window, Cam
     }
 
     XMLElement* groupElement = worldElement->FirstChildElement("group");
-    if (groupElement) {
-        XMLElement* modelsElement = groupElement->FirstChildElement("models");
-        if (modelsElement) {
-            parseModels(modelsElement, group);
-        }
+    while (groupElement) {
+        parseGroup(groupElement, -1, scene);
+        groupElement = groupElement->NextSiblingElement("group");
     }
 
     return true;
 }
 
-void SimpleParser::parseModels(XMLElement* modelsElement, Group& group) {
+// Groups are added before their children, which keeps the scene in topological order
+void SimpleParser::parseGroup(XMLElement* groupElement, int parent, Scene& scene) {
+    int group = scene.addGroup(parent, Mat4::identity());
+    parseTransform(groupElement->FirstChildElement("transform"), group, scene);
+
+    XMLElement* modelsElement = groupElement->FirstChildElement("models");
+    if (modelsElement) {
+        parseModels(modelsElement, group, scene);
+    }
+
+    XMLElement* childElement = groupElement->FirstChildElement("group");
+    while (childElement) {
+        parseGroup(childElement, group, scene);
+        childElement = childElement->NextSiblingElement("group");
+    }
+}
+
+// Translate, rotate and scale are applied in the order they are written, like the
+// equivalent glTranslatef/glRotatef/glScalef calls. A translate or rotate with a
+// time attribute is animated: the static transforms around it are kept as matrices.
+void SimpleParser::parseTransform(XMLElement* transformElement, int group, Scene& scene) {
+    if (!transformElement) return;
+
+    Mat4 local = Mat4::identity();
+    vector<AnimatedStep> steps;
+    for (XMLElement* element = transformElement->FirstChildElement(); element;
+         element = element->NextSiblingElement()) {
+        string name = element->Name();
+        float x = name == "scale" ? 1.0f : 0.0f, y = x, z = x;
+        element->QueryFloatAttribute("x", &x);
+        element->QueryFloatAttribute("y", &y);
+        element->QueryFloatAttribute("z", &z);
+        float time = 0;
+        bool animated = element->QueryFloatAttribute("time", &time) == XML_SUCCESS;
+
+        int animation = -1;
+        if (name == "translate" && animated) {
+            animation = parseCurve(element, time, scene);
+        } else if (name == "translate") {
+            local = local * Mat4::translation(x, y, z);
+        } else if (name == "rotate" && animated) {
+            animation = scene.animations.addRotation(time, x, y, z);
+        } else if (name == "rotate") {
+            float angle = 0;
+            element->QueryFloatAttribute("angle", &angle);
+            local = local * Mat4::rotation(angle, x, y, z);
+        } else if (name == "scale") {
+            local = local * Mat4::scaling(x, y, z);
+        } else {
+            cerr << "Unknown transform ignored: " << name << endl;
+        }
+
+        if (animation >= 0) {
+            steps.push_back({local, animation});
+            local = Mat4::identity();
+        }
+    }
+
+    if (steps.empty()) {
+        scene.setLocal(group, local);
+    } else {
+        scene.setAnimated(group, steps, local);
+    }
+}
+
+// Closed Catmull-Rom curve through the <point> elements, one lap every time seconds
+int SimpleParser::parseCurve(XMLElement* translateElement, float time, Scene& scene) {
+    bool align = false;
+    translateElement->QueryBoolAttribute("align", &align);
+
+    vector<Vertex> points;
+    for (XMLElement* pointElement = translateElement->FirstChildElement("point"); pointElement;
+         pointElement = pointElement->NextSiblingElement("point")) {
+        Vertex point;
+        pointElement->QueryFloatAttribute("x", &point.x);
+        pointElement->QueryFloatAttribute("y", &point.y);
+        pointElement->QueryFloatAttribute("z", &point.z);
+        points.push_back(point);
+    }
+    return scene.animations.addCurve(points, time, align);
+}
+
+void SimpleParser::parseModels(XMLElement* modelsElement, int group, Scene& scene) {
     if (!modelsElement) return;
     
     XMLElement* modelElement = modelsElement->FirstChildElement("model");
     while (modelElement) {
         const char* filename = modelElement->Attribute("file");
         if (filename) {
-            Model model;
-            // Adicionar o prefixo da pasta files3d/ ao nome do ficheiro
-            model.filename = "files3d/" + std::string(filename);
-            group.models.push_back(model);
+            // The name is kept as written, the resource manager finds the file in its search paths
+            size_t files = scene.modelFiles.size();
+            scene.addInstance(group, scene.addModelFile(filename));
             
-            cout << "Model found: " << model.filename << endl;
+            if (scene.modelFiles.size() > files) {
+                cout << "Model found: " << filename << endl;
+            }
         }
         modelElement = modelElement->NextSiblingElement("model");
     }
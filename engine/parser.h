@@ -3,6 +3,7 @@
 #include <vector>
 #include <fstream>
 #include "camera.h"
+#include "scene.h"
 #include "tinyxml2.h"
 
 struct Window {
@@ -11,18 +12,14 @@ struct Window {
     Window() : width(800), height(600) {}
 };
 
-struct Model {
-    std::string filename;
-};
-
-struct Group {
-    std::vector<Model> models;
-};
-
 class SimpleParser {
 public:
-    static bool parseXMLFile(const std::string& filename, Window& window, Camera& camera, Group& group);
+    // Read the window, camera and the <group> hierarchy, flattened into the scene
+    static bool parseXMLFile(const std::string& filename, Window& window, Camera& camera, Scene& scene);
     
 private:
-    static void parseModels(tinyxml2::XMLElement* modelsElement, Group& group);
+    static void parseGroup(tinyxml2::XMLElement* groupElement, int parent, Scene& scene);
+    static void parseTransform(tinyxml2::XMLElement* transformElement, int group, Scene& scene);
+    static int parseCurve(tinyxml2::XMLElement* translateElement, float time, Scene& scene);
+    static void parseModels(tinyxml2::XMLElement* modelsElement, int group, Scene& scene);
 };
\ No newline at end of file
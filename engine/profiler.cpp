@@ -0,0 +1,253 @@
+#define GL_GLEXT_PROTOTYPES
+#include "profiler.h"
+#include <GL/glut.h>
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+using namespace std;
+
+FrameProfiler::FrameProfiler()
+    : origin(Clock::now()), head(0), count(0), frameStart(0),
+      gpuQueryNext(0), gpuActive(false), gpuAvailable(false), frameNumber(0), pendingUploadBytes(0),
+      overlayVisible(false) {
+    for (int i = 0; i < PROFILE_SECTION_COUNT; i++) sectionStart[i] = 0;
+    for (int i = 0; i < GPU_QUERY_COUNT; i++) {
+        gpuQueries[i] = 0;
+        gpuQueryFrame[i] = -1;
+    }
+}
+
+double FrameProfiler::nowMs() const {
+    return chrono::duration<double, milli>(Clock::now() - origin).count();
+}
+
+void FrameProfiler::initGL() {
+    // GL_TIME_ELAPSED queries are core since OpenGL 3.3 (GL_ARB_timer_query before that)
+    int major = 0, minor = 0;
+    const char* version = (const char*) glGetString(GL_VERSION);
+    if (version) sscanf(version, "%d.%d", &major, &minor);
+
+    gpuAvailable = major > 3 || (major == 3 && minor >= 3);
+    if (gpuAvailable) {
+        glGenQueries(GPU_QUERY_COUNT, gpuQueries);
+    }
+}
+
+void FrameProfiler::beginFrame() {
+    collectGpuResults();
+
+    samples[head] = FrameSample();
+    frameStart = nowMs();
+    samples[head].startMs = frameStart;
+}
+
+void FrameProfiler::endFrame() {
+    samples[head].frameMs = nowMs() - frameStart;
+    samples[head].stats.bytesUploaded += pendingUploadBytes;
+    pendingUploadBytes = 0;
+
+    frameNumber++;
+    head = frameNumber % HISTORY_SIZE;
+    if (count < HISTORY_SIZE) count++;
+}
+
+void FrameProfiler::beginSection(ProfileSection section) {
+    sectionStart[section] = nowMs();
+}
+
+void FrameProfiler::endSection(ProfileSection section) {
+    samples[head].sectionMs[section] += nowMs() - sectionStart[section];
+}
+
+void FrameProfiler::addSectionMs(ProfileSection section, double ms) {
+    samples[head].sectionMs[section] += ms;
+}
+
+void FrameProfiler::beginGpu() {
+    if (!gpuAvailable || gpuActive) return;
+
+    // Skip GPU timing for this frame if the next query still has no result
+    if (gpuQueryFrame[gpuQueryNext] != -1) return;
+
+    glBeginQuery(GL_TIME_ELAPSED, gpuQueries[gpuQueryNext]);
+    gpuActive = true;
+}
+
+void FrameProfiler::endGpu() {
+    if (!gpuActive) return;
+
+    glEndQuery(GL_TIME_ELAPSED);
+    gpuQueryFrame[gpuQueryNext] = frameNumber;
+    gpuQueryNext = (gpuQueryNext + 1) % GPU_QUERY_COUNT;
+    gpuActive = false;
+}
+
+// Read back finished queries without stalling the pipeline
+void FrameProfiler::collectGpuResults() {
+    if (!gpuAvailable) return;
+
+    for (int i = 0; i < GPU_QUERY_COUNT; i++) {
+        if (gpuQueryFrame[i] == -1) continue;
+
+        GLuint available = 0;
+        glGetQueryObjectuiv(gpuQueries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) continue;
+
+        GLuint64 elapsedNs = 0;
+        glGetQueryObjectui64v(gpuQueries[i], GL_QUERY_RESULT, &elapsedNs);
+
+        // Only store the result if the frame is still in the ring buffer
+        if (frameNumber - gpuQueryFrame[i] < HISTORY_SIZE) {
+            samples[gpuQueryFrame[i] % HISTORY_SIZE].gpuMs = elapsedNs / 1.0e6;
+        }
+        gpuQueryFrame[i] = -1;
+    }
+}
+
+void FrameProfiler::countDraw(long objects, long triangles, long vertices) {
+    RenderStats& stats = samples[head].stats;
+    stats.drawCalls++;
+    stats.objectsDrawn += objects;
+    stats.triangles += triangles;
+    stats.vertices += vertices;
+}
+
+void FrameProfiler::countStateChanges(long issued, long filtered) {
+    samples[head].stats.stateChanges += issued;
+    samples[head].stats.filteredCalls += filtered;
+}
+
+void FrameProfiler::countObjects(long visited, long frustumCulled, long occluded) {
+    RenderStats& stats = samples[head].stats;
+    stats.objectsVisited += visited;
+    stats.frustumCulled += frustumCulled;
+    stats.occluded += occluded;
+}
+
+void FrameProfiler::countSceneUpdate(long nodes, long bounds) {
+    RenderStats& stats = samples[head].stats;
+    stats.nodesUpdated += nodes;
+    stats.boundsUpdated += bounds;
+}
+
+void FrameProfiler::setResources(long resident, long cpuBytes, long gpuBytes, long evictions, long reloads,
+                                 long pending) {
+    RenderStats& stats = samples[head].stats;
+    stats.modelsResident = resident;
+    stats.cpuBytes = cpuBytes;
+    stats.gpuBytes = gpuBytes;
+    stats.evictions = evictions;
+    stats.reloads = reloads;
+    stats.modelsPending = pending;
+}
+
+void FrameProfiler::countUpload(long bytes) {
+    pendingUploadBytes += bytes;
+}
+
+const FrameSample& FrameProfiler::sample(int age) const {
+    int index = ((head - 1 - age) % HISTORY_SIZE + HISTORY_SIZE) % HISTORY_SIZE;
+    return samples[index];
+}
+
+double FrameProfiler::fps() const {
+    if (count < 2) return 0.0;
+
+    double span = sample(0).startMs - sample(count - 1).startMs;
+    if (span <= 0.0) return 0.0;
+    return (count - 1) * 1000.0 / span;
+}
+
+double FrameProfiler::frameTimePercentile(double p) const {
+    if (count == 0) return 0.0;
+
+    vector<double> times(count);
+    for (int i = 0; i < count; i++) times[i] = sample(i).frameMs;
+
+    size_t k = (size_t) (p / 100.0 * (count - 1) + 0.5);
+    nth_element(times.begin(), times.begin() + k, times.end());
+    return times[k];
+}
+
+double FrameProfiler::averageSectionMs(ProfileSection section) const {
+    if (count == 0) return 0.0;
+
+    double total = 0.0;
+    for (int i = 0; i < count; i++) total += sample(i).sectionMs[section];
+    return total / count;
+}
+
+double FrameProfiler::averageGpuMs() const {
+    double total = 0.0;
+    int samplesWithGpu = 0;
+    for (int i = 0; i < count; i++) {
+        if (sample(i).gpuMs >= 0.0) {
+            total += sample(i).gpuMs;
+            samplesWithGpu++;
+        }
+    }
+    return samplesWithGpu > 0 ? total / samplesWithGpu : -1.0;
+}
+
+// Draw the statistics as bitmap text in the top-left corner of the window
+void FrameProfiler::drawOverlay(int width, int height, GLStateCache& state) const {
+    const int LINE_COUNT = 9;
+    char lines[LINE_COUNT][128];
+    const RenderStats& last = (count > 0 ? sample(0) : samples[head]).stats;
+
+    snprintf(lines[0], sizeof(lines[0]), "FPS: %.1f", fps());
+    snprintf(lines[1], sizeof(lines[1]), "Frame ms  p50 %.2f  p95 %.2f  p99 %.2f",
+             frameTimePercentile(50), frameTimePercentile(95), frameTimePercentile(99));
+    snprintf(lines[2], sizeof(lines[2]), "CPU ms  traversal %.2f  culling %.2f  sorting %.2f  submission %.2f",
+             averageSectionMs(PROFILE_TRAVERSAL), averageSectionMs(PROFILE_CULLING),
+             averageSectionMs(PROFILE_SORTING), averageSectionMs(PROFILE_SUBMISSION));
+
+    double gpuMs = averageGpuMs();
+    if (gpuMs >= 0.0) {
+        snprintf(lines[3], sizeof(lines[3]), "GPU ms  %.2f", gpuMs);
+    } else {
+        snprintf(lines[3], sizeof(lines[3]), "GPU ms  n/a");
+    }
+    snprintf(lines[4], sizeof(lines[4]), "Objects: visited %ld  culled %ld (frustum %ld, occluded %ld)  drawn %ld",
+             last.objectsVisited, last.objectsCulled(), last.frustumCulled, last.occluded, last.objectsDrawn);
+    snprintf(lines[5], sizeof(lines[5]), "Draw calls: %ld  state changes: %ld  filtered: %ld",
+             last.drawCalls, last.stateChanges, last.filteredCalls);
+    snprintf(lines[6], sizeof(lines[6]), "Triangles: %ld  vertices: %ld  uploaded: %ld bytes",
+             last.triangles, last.vertices, last.bytesUploaded);
+    snprintf(lines[7], sizeof(lines[7]), "Scene: nodes recomputed %ld  bounds updated %ld",
+             last.nodesUpdated, last.boundsUpdated);
+    snprintf(lines[8], sizeof(lines[8]), "Models: resident %ld  CPU %ld KB  GPU %ld KB  evictions %ld  reloads %ld  pending %ld",
+             last.modelsResident, last.cpuBytes / 1024, last.gpuBytes / 1024, last.evictions, last.reloads,
+             last.modelsPending);
+
+    // Switch to a pixel-aligned orthographic projection
+    state.matrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    gluOrtho2D(0, width, height, 0);
+    state.matrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    glPushAttrib(GL_CURRENT_BIT);
+    bool depthTest = state.isEnabled(GL_DEPTH_TEST);
+    state.disable(GL_DEPTH_TEST);
+    glColor3f(1.0f, 1.0f, 0.0f);
+
+    for (int i = 0; i < LINE_COUNT; i++) {
+        glRasterPos2i(10, 20 + i * 15);
+        for (const char* c = lines[i]; *c; c++) {
+            glutBitmapCharacter(GLUT_BITMAP_8_BY_13, *c);
+        }
+    }
+
+    state.setEnabled(GL_DEPTH_TEST, depthTest);
+    glPopAttrib();
+
+    // Popping restores the matrices the state cache knows about
+    state.matrixMode(GL_PROJECTION);
+    glPopMatrix();
+    state.matrixMode(GL_MODELVIEW);
+    glPopMatrix();
+}
@@ -0,0 +1,123 @@
+#pragma once
+#include <chrono>
+#include "glstate.h"
+#include "renderstats.h"
+
+// CPU sections timed inside renderScene
+enum ProfileSection {
+    PROFILE_TRAVERSAL,
+    PROFILE_CULLING,
+    PROFILE_SORTING,
+    PROFILE_SUBMISSION,
+    PROFILE_SECTION_COUNT
+};
+
+// Timings and counters recorded for a single frame
+struct FrameSample {
+    double startMs;                          // Frame start, relative to profiler creation
+    double frameMs;                          // CPU time from beginFrame to endFrame
+    double sectionMs[PROFILE_SECTION_COUNT]; // CPU time per section
+    double gpuMs;                            // GPU time (-1 while the query is pending)
+    RenderStats stats;
+
+    FrameSample() : startMs(0), frameMs(0), gpuMs(-1) {
+        for (int i = 0; i < PROFILE_SECTION_COUNT; i++) sectionMs[i] = 0;
+    }
+};
+
+class FrameProfiler {
+public:
+    // Number of recent frames kept in the ring buffer
+    static const int HISTORY_SIZE = 240;
+
+    // Number of GPU timer queries in flight (results are read a few frames later)
+    static const int GPU_QUERY_COUNT = 4;
+
+    FrameProfiler();
+
+    // Create the GL timer queries (requires a current GL context)
+    void initGL();
+
+    // Frame boundaries
+    void beginFrame();
+    void endFrame();
+
+    // CPU sections
+    void beginSection(ProfileSection section);
+    void endSection(ProfileSection section);
+
+    // Add time measured elsewhere (e.g. on the frame preparation thread) to a section
+    void addSectionMs(ProfileSection section, double ms);
+
+    // GPU pass timed with GL_TIME_ELAPSED
+    void beginGpu();
+    void endGpu();
+
+    // Account for a draw call covering the given objects and geometry
+    void countDraw(long objects, long triangles, long vertices);
+
+    // Account for GL state calls issued and filtered by the state cache
+    void countStateChanges(long issued, long filtered);
+
+    // Account for the objects traversed and those removed by culling
+    void countObjects(long visited, long frustumCulled, long occluded);
+
+    // Account for the scene groups and instances moved before the traversal
+    void countSceneUpdate(long nodes, long bounds);
+
+    // Record the model residency at the end of the frame
+    void setResources(long resident, long cpuBytes, long gpuBytes, long evictions, long reloads, long pending);
+
+    // Account for buffer data sent to the GPU; uploads outside a frame go to the next one
+    void countUpload(long bytes);
+
+    // Statistics over the ring buffer
+    int frameCount() const { return count; }
+    long finishedFrames() const { return frameNumber; }
+    const FrameSample& sample(int age) const; // age 0 = most recent finished frame
+    double fps() const;
+    double frameTimePercentile(double p) const;
+    double averageSectionMs(ProfileSection section) const;
+    double averageGpuMs() const;
+
+    // On-screen overlay
+    bool isOverlayVisible() const { return overlayVisible; }
+    void toggleOverlay() { overlayVisible = !overlayVisible; }
+    void drawOverlay(int width, int height, GLStateCache& state) const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    double nowMs() const;
+    void collectGpuResults();
+
+    Clock::time_point origin;
+    FrameSample samples[HISTORY_SIZE];
+    int head;   // Index of the frame being recorded
+    int count;  // Number of finished frames in the ring
+
+    double frameStart;
+    double sectionStart[PROFILE_SECTION_COUNT];
+
+    unsigned int gpuQueries[GPU_QUERY_COUNT];
+    long gpuQueryFrame[GPU_QUERY_COUNT]; // Frame number each query belongs to (-1 if free)
+    int gpuQueryNext;
+    bool gpuActive;
+    bool gpuAvailable;
+    long frameNumber;
+    long pendingUploadBytes;
+
+    bool overlayVisible;
+};
+
+// Times a CPU section for the lifetime of the object
+class ProfileScope {
+public:
+    ProfileScope(FrameProfiler& profiler, ProfileSection section)
+        : profiler(profiler), section(section) { profiler.beginSection(section); }
+    ~ProfileScope() { profiler.endSection(section); }
+
+private:
+    FrameProfiler& profiler;
+    ProfileSection section;
+};
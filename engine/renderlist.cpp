@@ -0,0 +1,213 @@
+#include "renderlist.h"
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+
+using namespace std;
+
+bool FrameRequest::sameAs(const FrameRequest& other) const {
+    const Camera& a = camera;
+    const Camera& b = other.camera;
+    return a.getPosX() == b.getPosX() && a.getPosY() == b.getPosY() && a.getPosZ() == b.getPosZ() &&
+           a.getLookAtX() == b.getLookAtX() && a.getLookAtY() == b.getLookAtY() && a.getLookAtZ() == b.getLookAtZ() &&
+           a.getUpX() == b.getUpX() && a.getUpY() == b.getUpY() && a.getUpZ() == b.getUpZ() &&
+           a.getFov() == b.getFov() && a.getNearPlane() == b.getNearPlane() && a.getFarPlane() == b.getFarPlane() &&
+           a.getAspect() == b.getAspect() && culling == other.culling && wireframe == other.wireframe;
+}
+
+static double elapsedMs(chrono::steady_clock::time_point since) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - since).count();
+}
+
+FramePreparer::FramePreparer(Scene& scene, const vector<ModelData>& models, OcclusionCuller& culler)
+    : scene(scene), models(models), culler(culler), listUnloaded(false) {}
+
+void FramePreparer::prepare(const FrameRequest& request, RenderList& list) {
+    // Matrices are computed on the list's own copy of the camera, so the main thread only reads them
+    list.request = request;
+    const Camera& camera = list.request.camera;
+    const Mat4& viewProj = camera.getViewProjectionMatrix();
+    camera.getViewMatrix();
+    list.frustumCulled = 0;
+    list.occluded = 0;
+
+    // Move the animated subtrees, then collect the instances that can be drawn.
+    // World matrices and bounds of static groups are precomputed.
+    auto start = chrono::steady_clock::now();
+    list.sceneUpdate = SceneUpdateStats{0, 0};
+    if (scene.isAnimated()) {
+        list.sceneUpdate = scene.animate(request.time, models);
+    }
+
+    candidates.clear();
+    unloaded.clear();
+    for (size_t i = 0; i < scene.instanceCount(); i++) {
+        const ModelData& modelData = models[scene.instanceModel[i]];
+        if (modelData.loaded && modelData.drawBuffer) {
+            candidates.push_back({&modelData, scene.instanceGroup[i], &scene.instanceWorld(i),
+                                  &scene.instanceBounds[i]});
+        } else if (listUnloaded && !modelData.loaded) {
+            unloaded.push_back({&modelData, scene.instanceGroup[i], &scene.instanceWorld(i),
+                                &scene.instanceBounds[i]});
+        }
+    }
+    list.visited = (int) candidates.size();
+    list.traversalMs = elapsedMs(start);
+
+    // Drop the instances outside the frustum or hidden behind the largest ones
+    start = chrono::steady_clock::now();
+    visible.clear();
+    if (request.culling) {
+        culler.prepare(viewProj, candidates);
+
+        for (const InstanceRef& instance : candidates) {
+            if (culler.isVisible(instance.bounds->min, instance.bounds->max)) {
+                visible.push_back(instance);
+            }
+        }
+
+        list.frustumCulled = culler.getStats().frustumCulled;
+        list.occluded = culler.getStats().occluded;
+    } else {
+        visible = candidates;
+    }
+
+    // Instances whose model is not loaded are not drawn and not counted, only their model is reported
+    list.unloadedModels.clear();
+    modelListed.resize(models.size(), 0);
+    for (const InstanceRef& instance : unloaded) {
+        int model = (int) (instance.model - models.data());
+        if (modelListed[model] || (request.culling && !culler.isVisible(instance.bounds->min, instance.bounds->max))) {
+            continue;
+        }
+        modelListed[model] = 1;
+        list.unloadedModels.push_back(model);
+    }
+    for (int model : list.unloadedModels) {
+        modelListed[model] = 0;
+    }
+    list.cullingMs = elapsedMs(start);
+
+    // Queue the visible instances front to back, grouped by material and mesh
+    start = chrono::steady_clock::now();
+    float dirX = camera.getLookAtX() - camera.getPosX();
+    float dirY = camera.getLookAtY() - camera.getPosY();
+    float dirZ = camera.getLookAtZ() - camera.getPosZ();
+    float length = sqrt(dirX * dirX + dirY * dirY + dirZ * dirZ);
+    float depthScale = length > 0.0f ? (RenderQueue::DEPTH_BUCKETS - 1) / (length * camera.getFarPlane()) : 0.0f;
+
+    // The scene moves on while the list is drawn, so the draws of an animated scene
+    // use a copy of its world matrices
+    if (scene.isAnimated()) {
+        list.groupWorld = scene.groupWorld;
+    }
+
+    // Models have no materials of their own yet, they all use the current render mode.
+    // Faces are drawn from both sides
+    list.queue.clear();
+    list.queue.clearMaterials();
+    MaterialState material = {request.wireframe, false};
+    unsigned int materialId = list.queue.addMaterial(material);
+
+    for (const InstanceRef& instance : visible) {
+        const Bounds& bounds = *instance.bounds;
+        float centerX = (bounds.min[0] + bounds.max[0]) * 0.5f - camera.getPosX();
+        float centerY = (bounds.min[1] + bounds.max[1]) * 0.5f - camera.getPosY();
+        float centerZ = (bounds.min[2] + bounds.max[2]) * 0.5f - camera.getPosZ();
+        float depth = (centerX * dirX + centerY * dirY + centerZ * dirZ) * depthScale;
+        unsigned int bucket = (unsigned int) min(max(depth, 0.0f), (float) (RenderQueue::DEPTH_BUCKETS - 1));
+
+        const ModelData* model = instance.model;
+        const Mat4* world = scene.isAnimated() ? &list.groupWorld[instance.group] : instance.world;
+        list.queue.push(makeSortKey(PASS_OPAQUE, bucket, materialId, model->drawBuffer), model, world);
+    }
+    list.queue.sort();
+    list.sortingMs = elapsedMs(start);
+}
+
+FramePipeline::FramePipeline(FramePreparer& preparer, bool threaded)
+    : preparer(preparer), threaded(threaded), front(0), back(1), middle(2),
+      requestedFrame(-1), publishedFrame(-1), nextFrame(0), stopping(false) {
+    if (threaded) {
+        worker = thread(&FramePipeline::workerLoop, this);
+    }
+}
+
+FramePipeline::~FramePipeline() {
+    if (!threaded) return;
+
+    {
+        lock_guard<std::mutex> lock(wakeMutex);
+        stopping.store(true);
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+void FramePipeline::request(const FrameRequest& frameRequest) {
+    if (!threaded) {
+        pending = frameRequest;
+        return;
+    }
+
+    // The worker is idle here: every earlier request was published before the consumer acquired it
+    waitForFrame(requestedFrame.load(memory_order_relaxed));
+    pending = frameRequest;
+    {
+        lock_guard<std::mutex> lock(wakeMutex);
+        requestedFrame.store(nextFrame++, memory_order_release);
+    }
+    wake.notify_one();
+}
+
+const RenderList& FramePipeline::acquire(const FrameRequest& frameRequest) {
+    if (!threaded) {
+        RenderList& list = slots[front];
+        preparer.prepare(frameRequest, list);
+        list.frame = nextFrame++;
+        return list;
+    }
+
+    // Input or a resize changed the view since the list was requested
+    if (requestedFrame.load(memory_order_relaxed) < 0 || !pending.sameAs(frameRequest)) {
+        request(frameRequest);
+    }
+
+    long frame = requestedFrame.load(memory_order_relaxed);
+    waitForFrame(frame);
+
+    // Pick up the newest list; the slot we give back becomes the producer's next target
+    if (middle.load(memory_order_acquire) & FRESH) {
+        front = middle.exchange(front, memory_order_acq_rel) & ~FRESH;
+    }
+    return slots[front];
+}
+
+// Spin until the worker published the given frame (normally it is already done)
+void FramePipeline::waitForFrame(long frame) {
+    while (publishedFrame.load(memory_order_acquire) < frame) {
+        this_thread::yield();
+    }
+}
+
+void FramePipeline::workerLoop() {
+    long prepared = -1;
+    while (true) {
+        {
+            unique_lock<std::mutex> lock(wakeMutex);
+            wake.wait(lock, [&] {
+                return stopping.load() || requestedFrame.load(memory_order_acquire) > prepared;
+            });
+        }
+        if (stopping.load()) break;
+
+        prepared = requestedFrame.load(memory_order_acquire);
+        RenderList& list = slots[back];
+        preparer.prepare(pending, list);
+        list.frame = prepared;
+
+        // Swap the finished list into the middle slot and take the old one as the next target
+        back = middle.exchange(back | FRESH, memory_order_acq_rel) & ~FRESH;
+        publishedFrame.store(prepared, memory_order_release);
+    }
+}
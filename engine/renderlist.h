@@ -0,0 +1,112 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "camera.h"
+#include "matrix.h"
+#include "model.h"
+#include "occlusion.h"
+#include "renderqueue.h"
+#include "scene.h"
+
+// Parameters a render list is prepared for
+struct FrameRequest {
+    Camera camera; // Including the viewport aspect ratio
+    bool culling;
+    bool wireframe;
+    double time;   // Animation time (s)
+
+    FrameRequest() : culling(true), wireframe(false), time(0) {}
+
+    // The animation time is not compared: a list prepared a frame ahead shows
+    // the animations as they were when it was requested
+    bool sameAs(const FrameRequest& other) const;
+};
+
+// Everything the main thread needs to submit one frame
+struct RenderList {
+    long frame;
+    FrameRequest request; // Its camera has the matrices of the frame computed
+    RenderQueue queue; // Visible instances, sorted for submission
+    std::vector<Mat4> groupWorld; // World matrices of an animated scene, the queue points into them
+
+    // Cost and results of the preparation, reported by the main thread
+    double traversalMs;
+    double cullingMs;
+    double sortingMs;
+    int visited;
+    int frustumCulled;
+    int occluded;
+    SceneUpdateStats sceneUpdate; // Work done to move the animated groups
+    std::vector<int> unloadedModels; // Models of visible instances that are not loaded (see setListUnloaded)
+
+    RenderList() : frame(-1), traversalMs(0), cullingMs(0), sortingMs(0), visited(0), frustumCulled(0), occluded(0),
+                   sceneUpdate{0, 0} {}
+};
+
+// Builds render lists: animation, traversal, culling and sorting of the scene
+// instances. The scene belongs to the thread preparing the lists.
+class FramePreparer {
+public:
+    // models holds the loaded model of each file in the scene
+    FramePreparer(Scene& scene, const std::vector<ModelData>& models, OcclusionCuller& culler);
+
+    // Also cull the instances whose model is not loaded and list their models in
+    // RenderList::unloadedModels, so evicted models can be loaded again
+    void setListUnloaded(bool list) { listUnloaded = list; }
+
+    void prepare(const FrameRequest& request, RenderList& list);
+
+private:
+    Scene& scene;
+    const std::vector<ModelData>& models;
+    OcclusionCuller& culler;
+    bool listUnloaded;
+    std::vector<InstanceRef> candidates;
+    std::vector<InstanceRef> visible;
+    std::vector<InstanceRef> unloaded;
+    std::vector<unsigned char> modelListed;
+};
+
+// Prepares the list of frame N+1 on a worker thread while the main thread submits frame N.
+// Lists are handed over through a triple buffer with atomic index swaps, neither side
+// takes a lock to publish or pick up a list.
+class FramePipeline {
+public:
+    // With threaded = false lists are prepared on the calling thread in acquire()
+    FramePipeline(FramePreparer& preparer, bool threaded);
+    ~FramePipeline();
+
+    // Start preparing a list for the given parameters
+    void request(const FrameRequest& request);
+
+    // Get the list for the given parameters. A list requested earlier with the same
+    // parameters is reused; otherwise (e.g. after input moved the camera) it is re-requested.
+    const RenderList& acquire(const FrameRequest& request);
+
+private:
+    static const int FRESH = 4; // Set in middle when it holds a list the consumer has not seen
+
+    void workerLoop();
+    void waitForFrame(long frame);
+
+    FramePreparer& preparer;
+    bool threaded;
+
+    RenderList slots[3];
+    int front; // Owned by the consumer
+    int back;  // Owned by the producer
+    std::atomic<int> middle;
+
+    FrameRequest pending;             // Written by the consumer before requestedFrame is bumped
+    std::atomic<long> requestedFrame;
+    std::atomic<long> publishedFrame;
+    long nextFrame;
+
+    std::thread worker;
+    std::mutex wakeMutex;             // Only used to sleep while there is nothing to prepare
+    std::condition_variable wake;
+    std::atomic<bool> stopping;
+};
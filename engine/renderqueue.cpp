@@ -0,0 +1,79 @@
+#define GL_GLEXT_PROTOTYPES
+#include "renderqueue.h"
+#include "glstate.h"
+#include "profiler.h"
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+using namespace std;
+
+SortKey makeSortKey(RenderPass pass, unsigned int depthBucket, unsigned int material, unsigned int mesh) {
+    return ((SortKey) (pass & 0xF) << 60) |
+           ((SortKey) (depthBucket & 0xFFF) << 48) |
+           ((SortKey) (material & 0xFFFF) << 32) |
+           (SortKey) mesh;
+}
+
+void RenderQueue::sort() {
+    size_t count = items.size();
+    if (count < 2) return;
+    scratch.resize(count);
+
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t histogram[256] = {0};
+        for (const DrawItem& item : items) {
+            histogram[(item.key >> shift) & 0xFF]++;
+        }
+
+        // Every key has the same byte here, the pass would not move anything
+        if (histogram[(items[0].key >> shift) & 0xFF] == count) continue;
+
+        size_t offset = 0;
+        for (int i = 0; i < 256; i++) {
+            size_t bucketSize = histogram[i];
+            histogram[i] = offset;
+            offset += bucketSize;
+        }
+
+        for (const DrawItem& item : items) {
+            scratch[histogram[(item.key >> shift) & 0xFF]++] = item;
+        }
+        items.swap(scratch);
+    }
+}
+
+unsigned int RenderQueue::addMaterial(const MaterialState& material) {
+    for (size_t i = 0; i < materials.size(); i++) {
+        if (materials[i].wireframe == material.wireframe && materials[i].cullFace == material.cullFace) {
+            return (unsigned int) i;
+        }
+    }
+    materials.push_back(material);
+    return (unsigned int) materials.size() - 1;
+}
+
+void submitQueue(const RenderQueue& queue, const Mat4& view, GLStateCache& state, FrameProfiler& profiler) {
+    const vector<MaterialState>& materials = queue.getMaterials();
+    const Mat4* world = nullptr;
+
+    for (const DrawItem& item : queue.getItems()) {
+        const MaterialState& material = materials[keyMaterial(item.key)];
+        const ModelData* model = item.model;
+
+        if (item.world != world) {
+            world = item.world;
+            state.loadModelView(view * *world);
+        }
+
+        state.polygonMode(material.wireframe ? GL_LINE : GL_FILL);
+        state.setEnabled(GL_CULL_FACE, material.cullFace);
+
+        // All models share the DrawVertex layout, the arrays stay enabled between frames
+        state.setClientState(GL_VERTEX_ARRAY, true);
+        state.setClientState(GL_COLOR_ARRAY, true);
+        state.drawVertexArrays(model->drawBuffer);
+
+        glDrawArrays(GL_TRIANGLES, (GLint) model->firstVertex, (GLsizei) model->drawVertices.size());
+        profiler.countDraw(1, model->triangleCount(), (long) model->drawVertices.size());
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "matrix.h"
+#include "model.h"
+
+class FrameProfiler;
+class GLStateCache;
+
+// Render passes, submitted in this order
+enum RenderPass {
+    PASS_OPAQUE = 0
+};
+
+// Fixed-function state a draw needs; materials are indices into a table of these
+struct MaterialState {
+    bool wireframe;
+    bool cullFace;
+};
+
+// Sort key, from the most to the least significant bits:
+//   pass (4) | depth bucket (12) | material (16) | mesh (32)
+// Draws of the same pass are ordered front to back in coarse buckets, so
+// draws at a similar depth are still grouped by material and mesh
+typedef uint64_t SortKey;
+
+SortKey makeSortKey(RenderPass pass, unsigned int depthBucket, unsigned int material, unsigned int mesh);
+
+const SortKey MATERIAL_KEY_MASK = (SortKey) 0xFFFF << 32;
+
+inline unsigned int keyMaterial(SortKey key) {
+    return (unsigned int) ((key & MATERIAL_KEY_MASK) >> 32);
+}
+
+struct DrawItem {
+    SortKey key;
+    const ModelData* model;
+    const Mat4* world; // World matrix of the instance, shared by the instances of a group
+};
+
+class RenderQueue {
+public:
+    static const int DEPTH_BUCKETS = 4096;
+
+    void clear() { items.clear(); }
+    void push(SortKey key, const ModelData* model, const Mat4* world) { items.push_back({key, model, world}); }
+
+    // LSD radix sort on the keys, 8 bits per pass (bytes equal in all keys are skipped)
+    void sort();
+
+    // Materials referenced by the keys
+    unsigned int addMaterial(const MaterialState& material);
+    void clearMaterials() { materials.clear(); }
+
+    const std::vector<DrawItem>& getItems() const { return items; }
+    const std::vector<MaterialState>& getMaterials() const { return materials; }
+
+private:
+    std::vector<DrawItem> items;
+    std::vector<DrawItem> scratch;
+    std::vector<MaterialState> materials;
+};
+
+// Issue the sorted draws through the state cache and count them. The modelview
+// matrix is only reloaded when the world matrix changes between draws.
+void submitQueue(const RenderQueue& queue, const Mat4& view, GLStateCache& state, FrameProfiler& profiler);
@@ -0,0 +1,51 @@
+#include "renderstats.h"
+#include <iostream>
+
+using namespace std;
+
+void RenderStats::print(ostream& out) const {
+    out << "Scene: " << nodesUpdated << " nodes recomputed, " << boundsUpdated << " instance bounds updated" << endl;
+    out << "Objects: " << objectsVisited << " visited, " << objectsCulled() << " culled ("
+        << frustumCulled << " frustum, " << occluded << " occluded), " << objectsDrawn << " drawn" << endl;
+    out << "Geometry: " << triangles << " triangles, " << vertices << " vertices" << endl;
+    out << "GL: " << drawCalls << " draw calls, " << stateChanges << " state changes, "
+        << filteredCalls << " redundant calls filtered, " << bytesUploaded << " bytes uploaded" << endl;
+    out << "Resources: " << modelsResident << " models resident (" << cpuBytes / 1024 << " KB CPU, "
+        << gpuBytes / 1024 << " KB GPU), " << evictions << " evictions, " << reloads << " reloads, " << modelsPending << " pending" << endl;
+}
+
+StatsDump::StatsDump() : interval(0) {}
+
+bool StatsDump::open(int dumpInterval, const string& csvFile) {
+    interval = dumpInterval;
+    if (interval <= 0 || csvFile.empty()) return true;
+
+    csv.open(csvFile);
+    if (!csv) {
+        cerr << "Error opening statistics file: " << csvFile << endl;
+        interval = 0;
+        return false;
+    }
+    csv << "frame,frame_ms,nodes_updated,bounds_updated,visited,frustum_culled,occluded,drawn,triangles,vertices,"
+           "draw_calls,state_changes,filtered_calls,bytes_uploaded,models_resident,cpu_bytes,gpu_bytes,evictions,reloads,"
+           "models_pending"
+        << endl;
+    return true;
+}
+
+void StatsDump::frameDone(long frame, double frameMs, const RenderStats& stats) {
+    if (interval <= 0 || frame % interval != 0) return;
+
+    if (csv.is_open()) {
+        csv << frame << ',' << frameMs << ',' << stats.nodesUpdated << ',' << stats.boundsUpdated << ','
+            << stats.objectsVisited << ',' << stats.frustumCulled << ','
+            << stats.occluded << ',' << stats.objectsDrawn << ',' << stats.triangles << ','
+            << stats.vertices << ',' << stats.drawCalls << ',' << stats.stateChanges << ','
+            << stats.filteredCalls << ',' << stats.bytesUploaded << ',' << stats.modelsResident << ','
+            << stats.cpuBytes << ',' << stats.gpuBytes << ',' << stats.evictions << ',' << stats.reloads << ','
+            << stats.modelsPending << '\n';
+    } else {
+        cout << "--- Frame " << frame << " (" << frameMs << " ms) ---" << endl;
+        stats.print(cout);
+    }
+}
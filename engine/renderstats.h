@@ -0,0 +1,51 @@
+#pragma once
+#include <fstream>
+#include <ostream>
+#include <string>
+
+// Counters of a single frame, filled by the frame preparation and submission code
+struct RenderStats {
+    long nodesUpdated;    // Scene groups whose world matrix was recomputed
+    long boundsUpdated;   // Instances whose world bounds were recomputed
+    long objectsVisited;  // Instances considered by the traversal
+    long frustumCulled;
+    long occluded;
+    long objectsDrawn;
+    long triangles;       // Submitted to the GPU
+    long vertices;
+    long drawCalls;
+    long stateChanges;    // GL state calls that reached the driver
+    long filteredCalls;   // Redundant state calls dropped by the state cache
+    long bytesUploaded;   // Buffer data sent to the GPU
+    long modelsResident;  // Models loaded at the end of the frame
+    long cpuBytes;        // Memory of the resident models
+    long gpuBytes;
+    long evictions;       // Models evicted so far
+    long reloads;         // Evicted models loaded again so far
+    long modelsPending;   // Streamed models wanted but not drawable yet
+
+    RenderStats() : nodesUpdated(0), boundsUpdated(0), objectsVisited(0), frustumCulled(0), occluded(0), objectsDrawn(0), triangles(0),
+                    vertices(0), drawCalls(0), stateChanges(0), filteredCalls(0), bytesUploaded(0),
+                    modelsResident(0), cpuBytes(0), gpuBytes(0), evictions(0), reloads(0), modelsPending(0) {}
+
+    long objectsCulled() const { return frustumCulled + occluded; }
+
+    // Multi-line human readable summary
+    void print(std::ostream& out) const;
+};
+
+// Periodic dump of the frame statistics (--stats N [--stats-csv FILE])
+class StatsDump {
+public:
+    StatsDump();
+
+    // Dump every interval frames to the CSV file, or to stdout if csvFile is empty
+    bool open(int interval, const std::string& csvFile);
+    bool isEnabled() const { return interval > 0; }
+
+    void frameDone(long frame, double frameMs, const RenderStats& stats);
+
+private:
+    int interval;
+    std::ofstream csv;
+};
@@ -0,0 +1,183 @@
+#include "resources.h"
+#include <algorithm>
+#include <iostream>
+#include <sys/stat.h>
+#include "assetpack.h"
+
+using namespace std;
+
+const char* const ResourceManager::DEFAULT_SEARCH_PATH = "files3d";
+
+static bool fileExists(const string& path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode);
+}
+
+static size_t modelBytes(const ModelData& model) {
+    return model.vertices.capacity() * sizeof(Vertex) + model.faces.capacity() * sizeof(Face) +
+           model.drawVertices.capacity() * sizeof(DrawVertex);
+}
+
+ResourceManager::ResourceManager()
+    : pack(nullptr), cpuBudget(0), gpuBudget(0), budgetWarned(false), modelGpuBytes(0), sharedGpuBytes(0), useClock(0),
+      stats() {}
+
+void ResourceManager::addSearchPath(const string& directory) {
+    searchPaths.push_back(directory);
+}
+
+string ResourceManager::resolve(const string& filename) const {
+    for (const string& directory : searchPaths) {
+        string path = directory + "/" + filename;
+        if (fileExists(path)) return path;
+    }
+    return filename;
+}
+
+void ResourceManager::setBudget(size_t cpuBytes, size_t gpuBytes) {
+    cpuBudget = cpuBytes;
+    gpuBudget = gpuBytes;
+    budgetWarned = false;
+}
+
+void ResourceManager::setModels(const vector<string>& files) {
+    size_t count = files.size();
+    modelData.assign(count, ModelData());
+    for (size_t i = 0; i < count; i++) {
+        modelData[i].filename = files[i];
+    }
+    refs.assign(count, 0);
+    lastUsed.assign(count, 0);
+    cpuBytes.assign(count, 0);
+    gpuBytes.assign(count, 0);
+    modelGpuBytes = 0;
+    sharedGpuBytes = 0;
+    evicted.assign(count, 0);
+    stats = ResourceStats();
+}
+
+void ResourceManager::addRef(int model) {
+    refs[model]++;
+}
+
+void ResourceManager::release(int model) {
+    if (refs[model] > 0 && --refs[model] == 0) {
+        lastUsed[model] = ++useClock;
+    }
+}
+
+bool ResourceManager::load(int model) {
+    if (modelData[model].loaded) return true;
+
+    ModelData data;
+    if (!read(model, data)) return false;
+    install(model, data);
+    return true;
+}
+
+bool ResourceManager::reload(int model) {
+    if (modelData[model].loaded) return true;
+    if (!evicted[model]) return false;
+    if (load(model)) return true;
+
+    evicted[model] = 0;
+    return false;
+}
+
+bool ResourceManager::read(int model, ModelData& out) const {
+    // The file name is kept as the scene refers to it, not as it was found
+    const string& filename = modelData[model].filename;
+    const char* content;
+    size_t size;
+    bool loaded = pack && pack->find(filename, content, size) ? loadModel(out, filename, content, size)
+                                                              : loadModel(out, resolve(filename));
+    out.filename = filename;
+    return loaded;
+}
+
+void ResourceManager::install(int model, ModelData& loaded) {
+    ModelData& data = modelData[model];
+    if (data.loaded) return;
+    data.vertices.swap(loaded.vertices);
+    data.faces.swap(loaded.faces);
+    data.drawVertices.swap(loaded.drawVertices);
+    copy(loaded.boundsMin, loaded.boundsMin + 3, data.boundsMin);
+    copy(loaded.boundsMax, loaded.boundsMax + 3, data.boundsMax);
+    data.loaded = true;
+
+    cpuBytes[model] = modelBytes(data);
+    lastUsed[model] = ++useClock;
+    stats.resident++;
+    stats.cpuBytes += cpuBytes[model];
+    stats.loads++;
+    if (evicted[model]) stats.reloads++;
+}
+
+void ResourceManager::setGpuBytes(int model, size_t bytes) {
+    modelGpuBytes = modelGpuBytes - gpuBytes[model] + bytes;
+    gpuBytes[model] = bytes;
+    stats.gpuBytes = modelGpuBytes + sharedGpuBytes;
+}
+
+void ResourceManager::setSharedGpuBytes(size_t bytes) {
+    sharedGpuBytes = bytes;
+    stats.gpuBytes = modelGpuBytes + sharedGpuBytes;
+}
+
+bool ResourceManager::overBudget() const {
+    return (cpuBudget > 0 && stats.cpuBytes > cpuBudget) || (gpuBudget > 0 && modelGpuBytes > gpuBudget);
+}
+
+int ResourceManager::enforceBudget() {
+    if (!overBudget()) return 0;
+
+    vector<int> candidates;
+    for (size_t i = 0; i < modelData.size(); i++) {
+        if (modelData[i].loaded && refs[i] == 0) candidates.push_back((int) i);
+    }
+    sort(candidates.begin(), candidates.end(), [this](int a, int b) { return lastUsed[a] < lastUsed[b]; });
+
+    int count = 0;
+    for (int model : candidates) {
+        if (!overBudget()) break;
+        evict(model);
+        count++;
+    }
+
+    // Models in use are never evicted, say so once instead of every frame
+    if (overBudget() && !budgetWarned) {
+        cerr << "Models in use exceed the memory budget (" << stats.cpuBytes / 1024 << " KB CPU, "
+             << stats.gpuBytes / 1024 << " KB GPU)" << endl;
+        budgetWarned = true;
+    }
+    return count;
+}
+
+int ResourceManager::evictUnreferenced() {
+    int count = 0;
+    for (size_t i = 0; i < modelData.size(); i++) {
+        if (modelData[i].loaded && refs[i] == 0) {
+            evict((int) i);
+            count++;
+        }
+    }
+    return count;
+}
+
+void ResourceManager::evict(int model) {
+    ModelData& data = modelData[model];
+    if (data.drawBuffer && gpuRelease) gpuRelease(data);
+    data.drawBuffer = 0;
+    setGpuBytes(model, 0);
+
+    vector<Vertex>().swap(data.vertices);
+    vector<Face>().swap(data.faces);
+    vector<DrawVertex>().swap(data.drawVertices);
+    data.loaded = false;
+
+    stats.resident--;
+    stats.cpuBytes -= cpuBytes[model];
+    cpuBytes[model] = 0;
+    stats.evictions++;
+    evicted[model] = 1;
+}
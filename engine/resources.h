@@ -0,0 +1,110 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <vector>
+#include "model.h"
+
+class AssetPack;
+
+// Residency of the models and what the manager did to keep it within the budget
+struct ResourceStats {
+    int resident;      // Models loaded
+    size_t cpuBytes;   // Vertices, faces and draw vertices of the resident models
+    size_t gpuBytes;   // Draw buffers uploaded, and the unused part of a buffer they share
+    long loads;
+    long reloads;      // Loads of models that had been evicted
+    long evictions;
+};
+
+// Owner of the model data of the scene, one entry per file in scene.modelFiles.
+// Model files are looked up in an asset pack, then in the search paths, then as
+// given. Each model counts the scene users referencing it; when the memory of the
+// resident models exceeds the budget, the least recently used unreferenced ones
+// are evicted and loaded again when a user comes back.
+// Used from the main (GL) thread only, except read().
+class ResourceManager {
+public:
+    static const char* const DEFAULT_SEARCH_PATH; // "files3d"
+
+    ResourceManager();
+
+    // Directories searched for model files, in the order they are added
+    void addSearchPath(const std::string& directory);
+    const std::vector<std::string>& getSearchPaths() const { return searchPaths; }
+
+    // Path of the model file in the first search path holding it, or the name as given
+    std::string resolve(const std::string& filename) const;
+
+    // Pack searched before the directories (nullptr for none), open while models load
+    void setPack(const AssetPack* assetPack) { pack = assetPack; }
+
+    // Memory budgets in bytes, 0 = no limit. The GPU budget is checked against the draw
+    // buffers of the models, which evicting frees; the owner of a shared buffer keeps
+    // its unused part within the budget.
+    void setBudget(size_t cpuBytes, size_t gpuBytes);
+    size_t getGpuBudget() const { return gpuBudget; }
+
+    // Set the model files; the list keeps its size afterwards, so indices and
+    // pointers into models() stay valid
+    void setModels(const std::vector<std::string>& files);
+    std::vector<ModelData>& models() { return modelData; }
+    size_t size() const { return modelData.size(); }
+
+    // Users of a model; an unreferenced model may be evicted
+    void addRef(int model);
+    void release(int model);
+    int refCount(int model) const { return refs[model]; }
+
+    // Load the model unless it is resident; false if it cannot be loaded
+    bool load(int model);
+
+    // load() for a model that was evicted; false for one that never loaded. A model
+    // that cannot be read again is not tried again.
+    bool reload(int model);
+
+    // load() in two steps, so the file can be read on another thread: read() only
+    // reads the manager, install() moves the loaded data in on the main thread
+    bool read(int model, ModelData& out) const;
+    void install(int model, ModelData& loaded);
+
+    // The model's draw buffer was uploaded (size in bytes) or freed (0)
+    void setGpuBytes(int model, size_t bytes);
+
+    // GPU memory held for the models but not by one of them, like the free space of a shared buffer
+    void setSharedGpuBytes(size_t bytes);
+
+    // Called for an evicted model that has a draw buffer, to free it
+    void setGpuRelease(std::function<void(ModelData&)> release) { gpuRelease = release; }
+
+    // Evict least recently used unreferenced models until the budget holds.
+    // Returns the number of models evicted.
+    int enforceBudget();
+
+    // Evict every model nobody references, returns how many
+    int evictUnreferenced();
+
+    const ResourceStats& getStats() const { return stats; }
+
+private:
+    void evict(int model);
+    bool overBudget() const;
+
+    std::vector<std::string> searchPaths;
+    const AssetPack* pack;
+    size_t cpuBudget;
+    size_t gpuBudget;
+    bool budgetWarned;
+
+    std::vector<ModelData> modelData;
+    std::vector<int> refs;
+    std::vector<long> lastUsed;     // Use clock value of the last load or release
+    std::vector<size_t> cpuBytes;
+    std::vector<size_t> gpuBytes;
+    size_t modelGpuBytes;
+    size_t sharedGpuBytes;
+    std::vector<unsigned char> evicted;
+    long useClock;
+
+    std::function<void(ModelData&)> gpuRelease;
+    ResourceStats stats;
+};
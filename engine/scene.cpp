@@ -0,0 +1,133 @@
+#include "scene.h"
+#include <algorithm>
+
+using namespace std;
+
+Scene::Scene() : dirtyBegin(0), dirtyEnd(0) {}
+
+int Scene::addGroup(int parent, const Mat4& local) {
+    groupParent.push_back(parent);
+    groupLocal.push_back(local);
+    groupWorld.push_back(local);
+    groupFlags.push_back(LOCAL_DIRTY);
+    groupSubtreeEnd.push_back((int) groupParent.size());
+    groupFirstInstance.push_back((int) instanceCount());
+    return (int) groupParent.size() - 1;
+}
+
+void Scene::setAnimated(int group, const vector<AnimatedStep>& steps, const Mat4& tail) {
+    animatedGroup.push_back(group);
+    animatedFirstStep.push_back((int) animatedSteps.size());
+    animatedStepCount.push_back((int) steps.size());
+    animatedTail.push_back(tail);
+    animatedSteps.insert(animatedSteps.end(), steps.begin(), steps.end());
+}
+
+int Scene::addModelFile(const string& filename) {
+    // Files a compiled scene put in the list directly are indexed on the first call
+    for (size_t i = modelFileIndex.size(); i < modelFiles.size(); i++) {
+        modelFileIndex.emplace(modelFiles[i], (int) i);
+    }
+    auto found = modelFileIndex.emplace(filename, (int) modelFiles.size());
+    if (found.second) modelFiles.push_back(filename);
+    return found.first->second;
+}
+
+void Scene::addInstance(int group, int model) {
+    instanceModel.push_back(model);
+    instanceGroup.push_back(group);
+    instanceBounds.push_back(Bounds());
+}
+
+void Scene::setLocal(int group, const Mat4& local) {
+    groupLocal[group] = local;
+    groupFlags[group] |= LOCAL_DIRTY;
+    dirtyBegin = min(dirtyBegin, group);
+    dirtyEnd = max(dirtyEnd, groupSubtreeEnd[group]);
+}
+
+SceneUpdateStats Scene::updateWorld(const vector<ModelData>& models) {
+    // A child ends its parent's subtree at least where its own one ends
+    for (int g = (int) groupCount() - 1; g >= 0; g--) {
+        int parent = groupParent[g];
+        if (parent >= 0) groupSubtreeEnd[parent] = max(groupSubtreeEnd[parent], groupSubtreeEnd[g]);
+    }
+
+    // Every group is new, sweep them all
+    updateAnimatedLocals(0.0);
+    dirtyBegin = 0;
+    dirtyEnd = (int) groupCount();
+    return update(models);
+}
+
+SceneUpdateStats Scene::animate(double seconds, const vector<ModelData>& models) {
+    updateAnimatedLocals(seconds);
+    return update(models);
+}
+
+SceneUpdateStats Scene::update(const vector<ModelData>& models) {
+    SceneUpdateStats stats = {0, 0};
+
+    // Parents come first: when a group is reached, its parent's flags say whether it moved
+    for (int g = dirtyBegin; g < dirtyEnd; g++) {
+        int parent = groupParent[g];
+        bool parentMoved = parent >= 0 && (groupFlags[parent] & WORLD_DIRTY);
+        if (!parentMoved && !(groupFlags[g] & LOCAL_DIRTY)) continue;
+
+        groupWorld[g] = parent < 0 ? groupLocal[g] : groupWorld[parent] * groupLocal[g];
+        groupFlags[g] = WORLD_DIRTY;
+        stats.groups++;
+
+        int firstInstance = groupFirstInstance[g];
+        int endInstance = g + 1 < (int) groupCount() ? groupFirstInstance[g + 1] : (int) instanceCount();
+        updateBounds(firstInstance, endInstance, models);
+        stats.instances += endInstance - firstInstance;
+    }
+
+    for (int g = dirtyBegin; g < dirtyEnd; g++) {
+        groupFlags[g] = 0;
+    }
+    dirtyBegin = (int) groupCount();
+    dirtyEnd = 0;
+    return stats;
+}
+
+void Scene::updateAnimatedLocals(double seconds) {
+    if (!isAnimated()) return;
+    animations.evaluate(seconds);
+
+    for (size_t a = 0; a < animatedGroup.size(); a++) {
+        const AnimatedStep* step = &animatedSteps[animatedFirstStep[a]];
+        Mat4 local = step[0].before * animations.matrix(step[0].animation);
+        for (int s = 1; s < animatedStepCount[a]; s++) {
+            local = local * step[s].before * animations.matrix(step[s].animation);
+        }
+        setLocal(animatedGroup[a], local * animatedTail[a]);
+    }
+}
+
+void Scene::updateModelBounds(int model, const vector<ModelData>& models) {
+    for (size_t i = 0; i < instanceCount(); i++) {
+        if (instanceModel[i] == model) updateBounds((int) i, (int) i + 1, models);
+    }
+}
+
+void Scene::updateBounds(int begin, int end, const vector<ModelData>& models) {
+    // World bounds enclose the eight transformed corners of the model bounds
+    for (int i = begin; i < end; i++) {
+        const ModelData& model = models[instanceModel[i]];
+        const Mat4& world = instanceWorld(i);
+        Bounds& bounds = instanceBounds[i];
+
+        for (int k = 0; k < 8; k++) {
+            float corner[4];
+            world.transformPoint(k & 1 ? model.boundsMax[0] : model.boundsMin[0],
+                                 k & 2 ? model.boundsMax[1] : model.boundsMin[1],
+                                 k & 4 ? model.boundsMax[2] : model.boundsMin[2], corner);
+            for (int axis = 0; axis < 3; axis++) {
+                bounds.min[axis] = k == 0 ? corner[axis] : min(bounds.min[axis], corner[axis]);
+                bounds.max[axis] = k == 0 ? corner[axis] : max(bounds.max[axis], corner[axis]);
+            }
+        }
+    }
+}
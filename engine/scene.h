@@ -0,0 +1,109 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "animation.h"
+#include "matrix.h"
+#include "model.h"
+
+// World-space axis-aligned bounding box
+struct Bounds {
+    float min[3], max[3];
+};
+
+// Instance as handed to culling and sorting
+struct InstanceRef {
+    const ModelData* model;
+    int group;
+    const Mat4* world;
+    const Bounds* bounds;
+};
+
+// Static transform followed by an animated step, part of an animated local matrix
+struct AnimatedStep {
+    Mat4 before;
+    int animation; // Step of Scene::animations
+};
+
+// Work done by one update of the world matrices
+struct SceneUpdateStats {
+    int groups;    // World matrices recomputed
+    int instances; // Instance bounds recomputed
+};
+
+// Models placed in the world. The <group> hierarchy of the XML file is flattened
+// at load time: groups are stored depth-first, so a parent always comes before its
+// children, and every <model> of a group becomes an instance. Instances are kept as
+// parallel arrays (structure of arrays), their world matrices and bounds are computed
+// once, so a static scene costs no matrix work per frame. Groups whose local matrix
+// changes are flagged, and an update recomputes only their subtrees in a single
+// sweep over the array.
+struct Scene {
+    static constexpr unsigned char LOCAL_DIRTY = 1; // Local matrix changed since the last update
+    static constexpr unsigned char WORLD_DIRTY = 2; // World matrix recomputed by the running update
+
+    // Groups, in topological order
+    std::vector<int> groupParent;  // -1 for top-level groups
+    std::vector<Mat4> groupLocal;  // Transform relative to the parent group
+    std::vector<Mat4> groupWorld;  // Shared by the instances of the group
+    std::vector<unsigned char> groupFlags;
+    std::vector<int> groupSubtreeEnd;    // One past the last group below it (subtrees are contiguous)
+    std::vector<int> groupFirstInstance; // Instances of a group are contiguous too
+
+    // Animated groups, in topological order. Their local matrix is
+    // before(0) * animation(0) * ... * before(n-1) * animation(n-1) * tail
+    std::vector<int> animatedGroup;
+    std::vector<int> animatedFirstStep;
+    std::vector<int> animatedStepCount;
+    std::vector<Mat4> animatedTail;
+    std::vector<AnimatedStep> animatedSteps;
+    SceneAnimations animations;
+
+    // Model files, loaded once however many instances use them
+    std::vector<std::string> modelFiles;
+
+    // Instances
+    std::vector<int> instanceModel;      // Index into modelFiles and the loaded models
+    std::vector<int> instanceGroup;
+    std::vector<Bounds> instanceBounds;  // Model bounds transformed to world space
+
+    Scene();
+
+    // Groups are added depth-first, each with its instances before its children
+    int addGroup(int parent, const Mat4& local);
+    void setAnimated(int group, const std::vector<AnimatedStep>& steps, const Mat4& tail);
+    int addModelFile(const std::string& filename);
+    void addInstance(int group, int model);
+
+    size_t groupCount() const { return groupParent.size(); }
+    size_t instanceCount() const { return instanceModel.size(); }
+    bool isAnimated() const { return !animatedGroup.empty(); }
+
+    const Mat4& instanceWorld(size_t instance) const { return groupWorld[instanceGroup[instance]]; }
+
+    // Replace the local matrix of a group; the next update() recomputes its subtree
+    void setLocal(int group, const Mat4& local);
+
+    // Compute every world matrix and instance bound once the scene is loaded (animations
+    // at time 0). models holds the loaded model of each entry of modelFiles.
+    SceneUpdateStats updateWorld(const std::vector<ModelData>& models);
+
+    // Recompute the world matrices and instance bounds below the changed groups
+    SceneUpdateStats update(const std::vector<ModelData>& models);
+
+    // Evaluate the animations at the given time and update the animated subtrees
+    SceneUpdateStats animate(double seconds, const std::vector<ModelData>& models);
+
+    // Recompute the bounds of the instances of a model whose data was (re)loaded
+    void updateModelBounds(int model, const std::vector<ModelData>& models);
+
+private:
+    void updateAnimatedLocals(double seconds);
+    void updateBounds(int begin, int end, const std::vector<ModelData>& models);
+
+    // Range of groups the next update sweeps, empty when nothing changed
+    int dirtyBegin, dirtyEnd;
+
+    // Entry of each file in modelFiles, so instances find their file in constant time
+    std::unordered_map<std::string, int> modelFileIndex;
+};
@@ -0,0 +1,381 @@
+#include "scenefile.h"
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+static_assert(sizeof(int) == 4, "scene files store indices as 32-bit ints");
+
+namespace {
+
+const char MAGIC[4] = {'W', 'S', 'C', 'N'};
+const size_t SECTION_ALIGN = 16;
+
+// Array in the file: byte offset and element count
+struct Section {
+    uint64_t offset;
+    uint64_t count;
+};
+
+// Animation step as stored: a curve through points, or a rotation
+struct AnimationRecord {
+    uint32_t curve;
+    float period;
+    uint32_t align;
+    float axis[3];
+    uint32_t firstPoint;
+    uint32_t pointCount;
+};
+
+// Animated step as stored: AnimatedStep without its alignment padding left uninitialized
+struct StepRecord {
+    float before[16];
+    int32_t animation;
+    uint32_t pad[3];
+};
+
+struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceSize;
+    int64_t sourceTime;   // Modification time of the XML source (ns)
+    int32_t windowWidth, windowHeight;
+    float camera[12];     // Position, lookAt, up, fov, near, far
+
+    Section sourcePath;   // Characters, without terminator
+    Section modelNames;   // Offsets into nameChars
+    Section nameChars;    // Null-terminated file names
+    Section groupParent;
+    Section groupLocal;
+    Section groupFirstInstance;
+    Section instanceModel;
+    Section instanceGroup;
+    Section animatedGroup;
+    Section animatedFirstStep;
+    Section animatedStepCount;
+    Section animatedTail;
+    Section animatedSteps;
+    Section animations;
+    Section curvePoints;
+};
+
+// Appends arrays to the file data, each starting on a SECTION_ALIGN boundary
+class SectionWriter {
+public:
+    explicit SectionWriter(vector<char>& data) : data(data) {}
+
+    template <typename T>
+    Section write(const T* values, size_t count) {
+        size_t padding = (SECTION_ALIGN - data.size() % SECTION_ALIGN) % SECTION_ALIGN;
+        data.resize(data.size() + padding, 0);
+
+        Section section = {data.size(), count};
+        data.insert(data.end(), (const char*) values, (const char*) (values + count));
+        return section;
+    }
+
+    template <typename T>
+    Section write(const vector<T>& values) { return write(values.data(), values.size()); }
+
+private:
+    vector<char>& data;
+};
+
+// Copy a section of the mapped file, false if it lies outside the file
+template <typename T>
+bool readSection(const char* base, size_t size, const Section& section, vector<T>& out) {
+    if (section.offset > size || section.offset % SECTION_ALIGN != 0 ||
+        section.count > (size - section.offset) / sizeof(T)) {
+        return false;
+    }
+    const T* data = (const T*) (base + section.offset);
+    out.assign(data, data + section.count);
+    return true;
+}
+
+bool sourceInfo(const string& filename, uint64_t& size, int64_t& time) {
+    struct stat info;
+    if (stat(filename.c_str(), &info) != 0) return false;
+    size = (uint64_t) info.st_size;
+    time = (int64_t) info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+    return true;
+}
+
+uint64_t headerEnd() {
+    return (sizeof(FileHeader) + SECTION_ALIGN - 1) / SECTION_ALIGN * SECTION_ALIGN;
+}
+
+} // namespace
+
+bool SceneFile::isSceneFile(const string& filename) {
+    return filename.size() > 4 && filename.compare(filename.size() - 4, 4, ".scn") == 0;
+}
+
+bool SceneFile::compile(const string& xmlFile, const string& sceneFile) {
+    vector<char> data;
+    if (!compile(xmlFile, data)) return false;
+
+    ofstream file(sceneFile, ios::binary);
+    file.write(data.data(), data.size());
+    if (!file) {
+        cerr << "Error writing compiled scene: " << sceneFile << endl;
+        return false;
+    }
+    cout << "Compiled scene written to " << sceneFile << endl;
+    return true;
+}
+
+bool SceneFile::compile(const string& xmlFile, vector<char>& data) {
+    Window window;
+    Camera camera;
+    Scene scene;
+    if (!SimpleParser::parseXMLFile(xmlFile, window, camera, scene)) return false;
+
+    FileHeader header = {};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    if (!sourceInfo(xmlFile, header.sourceSize, header.sourceTime)) {
+        cerr << "Error reading XML file information: " << xmlFile << endl;
+        return false;
+    }
+    header.windowWidth = window.width;
+    header.windowHeight = window.height;
+    const float cameraValues[12] = {
+        camera.getPosX(), camera.getPosY(), camera.getPosZ(),
+        camera.getLookAtX(), camera.getLookAtY(), camera.getLookAtZ(),
+        camera.getUpX(), camera.getUpY(), camera.getUpZ(),
+        camera.getFov(), camera.getNearPlane(), camera.getFarPlane()};
+    memcpy(header.camera, cameraValues, sizeof(cameraValues));
+
+    // Model file names, one null-terminated string each
+    vector<uint32_t> nameOffsets;
+    vector<char> nameChars;
+    for (const string& name : scene.modelFiles) {
+        nameOffsets.push_back((uint32_t) nameChars.size());
+        nameChars.insert(nameChars.end(), name.c_str(), name.c_str() + name.size() + 1);
+    }
+
+    // Animation steps in step order, so adding them again gives the same indices
+    vector<AnimationRecord> animations;
+    vector<Vertex> curvePoints;
+    for (int step = 0; step < (int) scene.animations.size(); step++) {
+        SceneAnimations::StepInfo info = scene.animations.stepInfo(step);
+        AnimationRecord record = {};
+        record.curve = info.curve;
+        record.period = info.period;
+        record.align = info.align;
+        memcpy(record.axis, info.axis, sizeof(record.axis));
+        record.firstPoint = (uint32_t) curvePoints.size();
+        record.pointCount = (uint32_t) info.points.size();
+        curvePoints.insert(curvePoints.end(), info.points.begin(), info.points.end());
+        animations.push_back(record);
+    }
+
+    // Static matrices of the animated steps, the padding zeroed so the file is reproducible
+    vector<StepRecord> steps(scene.animatedSteps.size(), StepRecord());
+    for (size_t i = 0; i < steps.size(); i++) {
+        memcpy(steps[i].before, scene.animatedSteps[i].before.m, sizeof(steps[i].before));
+        steps[i].animation = scene.animatedSteps[i].animation;
+    }
+
+    // The header is written last, once the sections are placed
+    data.assign(headerEnd(), 0);
+
+    SectionWriter writer(data);
+    header.sourcePath = writer.write(xmlFile.data(), xmlFile.size());
+    header.modelNames = writer.write(nameOffsets);
+    header.nameChars = writer.write(nameChars);
+    header.groupParent = writer.write(scene.groupParent);
+    header.groupLocal = writer.write(scene.groupLocal);
+    header.groupFirstInstance = writer.write(scene.groupFirstInstance);
+    header.instanceModel = writer.write(scene.instanceModel);
+    header.instanceGroup = writer.write(scene.instanceGroup);
+    header.animatedGroup = writer.write(scene.animatedGroup);
+    header.animatedFirstStep = writer.write(scene.animatedFirstStep);
+    header.animatedStepCount = writer.write(scene.animatedStepCount);
+    header.animatedTail = writer.write(scene.animatedTail);
+    header.animatedSteps = writer.write(steps);
+    header.animations = writer.write(animations);
+    header.curvePoints = writer.write(curvePoints);
+    memcpy(data.data(), &header, sizeof(header));
+
+    cout << "Compiled scene: " << scene.groupCount() << " groups, " << scene.instanceCount() << " instances, "
+         << scene.modelFiles.size() << " model files" << endl;
+    return true;
+}
+
+// Check the references between the arrays, so a damaged file cannot index out of bounds
+static bool validScene(const Scene& scene, const vector<AnimationRecord>& animations, size_t pointCount) {
+    int groups = (int) scene.groupCount();
+    int instances = (int) scene.instanceCount();
+    if ((int) scene.groupLocal.size() != groups || (int) scene.groupFirstInstance.size() != groups ||
+        scene.instanceGroup.size() != scene.instanceModel.size()) {
+        return false;
+    }
+
+    for (int g = 0; g < groups; g++) {
+        int parent = scene.groupParent[g];
+        int first = scene.groupFirstInstance[g];
+        if (parent < -1 || parent >= g) return false;
+        if (first < 0 || first > instances || (g > 0 && first < scene.groupFirstInstance[g - 1])) return false;
+    }
+    for (int i = 0; i < instances; i++) {
+        if (scene.instanceModel[i] < 0 || scene.instanceModel[i] >= (int) scene.modelFiles.size()) return false;
+        if (scene.instanceGroup[i] < 0 || scene.instanceGroup[i] >= groups) return false;
+    }
+
+    size_t animated = scene.animatedGroup.size();
+    if (scene.animatedFirstStep.size() != animated || scene.animatedStepCount.size() != animated ||
+        scene.animatedTail.size() != animated) {
+        return false;
+    }
+    for (size_t a = 0; a < animated; a++) {
+        int first = scene.animatedFirstStep[a];
+        int count = scene.animatedStepCount[a];
+        int group = scene.animatedGroup[a];
+        if (group < 0 || group >= groups || (a > 0 && group <= scene.animatedGroup[a - 1])) return false;
+        if (first < 0 || count < 1 || (size_t) first + count > scene.animatedSteps.size()) return false;
+    }
+    for (const AnimatedStep& step : scene.animatedSteps) {
+        if (step.animation < 0 || step.animation >= (int) animations.size()) return false;
+    }
+    for (const AnimationRecord& record : animations) {
+        if (record.curve && (uint64_t) record.firstPoint + record.pointCount > pointCount) return false;
+    }
+    return true;
+}
+
+SceneFileResult SceneFile::load(const string& sceneFile, Window& window, Camera& camera, Scene& scene,
+                                string& sourceFile) {
+    int fd = open(sceneFile.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        cerr << "Error opening compiled scene: " << sceneFile << endl;
+        if (fd >= 0) close(fd);
+        return SCENE_FILE_ERROR;
+    }
+
+    size_t size = (size_t) info.st_size;
+    void* mapping = size >= sizeof(FileHeader) ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        cerr << "Not a compiled scene: " << sceneFile << endl;
+        return SCENE_FILE_ERROR;
+    }
+
+    SceneFileResult result = load((const char*) mapping, size, sceneFile, window, camera, scene, &sourceFile);
+    munmap(mapping, size);
+    return result;
+}
+
+SceneFileResult SceneFile::load(const char* base, size_t size, const string& sceneFile, Window& window,
+                                Camera& camera, Scene& scene, string* sourceFile) {
+    auto start = chrono::steady_clock::now();
+    if (size < sizeof(FileHeader)) {
+        cerr << "Not a compiled scene: " << sceneFile << endl;
+        return SCENE_FILE_ERROR;
+    }
+
+    FileHeader header;
+    memcpy(&header, base, sizeof(header));
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION) {
+        cerr << "Not a compiled scene (or unsupported version): " << sceneFile << endl;
+        return SCENE_FILE_ERROR;
+    }
+
+    vector<char> path;
+    bool valid = readSection(base, size, header.sourcePath, path);
+
+    // A scene shipped without its XML is used as is
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    if (valid && sourceFile) {
+        sourceFile->assign(path.begin(), path.end());
+        if (sourceInfo(*sourceFile, sourceSize, sourceTime) &&
+            (sourceSize != header.sourceSize || sourceTime != header.sourceTime)) {
+            return SCENE_FILE_STALE;
+        }
+    }
+
+    vector<uint32_t> nameOffsets;
+    vector<char> nameChars;
+    vector<StepRecord> steps;
+    vector<AnimationRecord> animations;
+    vector<Vertex> curvePoints;
+    valid = valid &&
+            readSection(base, size, header.modelNames, nameOffsets) &&
+            readSection(base, size, header.nameChars, nameChars) &&
+            readSection(base, size, header.groupParent, scene.groupParent) &&
+            readSection(base, size, header.groupLocal, scene.groupLocal) &&
+            readSection(base, size, header.groupFirstInstance, scene.groupFirstInstance) &&
+            readSection(base, size, header.instanceModel, scene.instanceModel) &&
+            readSection(base, size, header.instanceGroup, scene.instanceGroup) &&
+            readSection(base, size, header.animatedGroup, scene.animatedGroup) &&
+            readSection(base, size, header.animatedFirstStep, scene.animatedFirstStep) &&
+            readSection(base, size, header.animatedStepCount, scene.animatedStepCount) &&
+            readSection(base, size, header.animatedTail, scene.animatedTail) &&
+            readSection(base, size, header.animatedSteps, steps) &&
+            readSection(base, size, header.animations, animations) &&
+            readSection(base, size, header.curvePoints, curvePoints);
+
+    scene.animatedSteps.resize(steps.size());
+    for (size_t i = 0; i < steps.size(); i++) {
+        memcpy(scene.animatedSteps[i].before.m, steps[i].before, sizeof(steps[i].before));
+        scene.animatedSteps[i].animation = steps[i].animation;
+    }
+    for (size_t i = 0; valid && i < nameOffsets.size(); i++) {
+        if (nameOffsets[i] >= nameChars.size() || nameChars.back() != '\0') {
+            valid = false;
+            break;
+        }
+        scene.modelFiles.push_back(&nameChars[nameOffsets[i]]);
+    }
+    if (!valid || !validScene(scene, animations, curvePoints.size())) {
+        cerr << "Compiled scene is damaged: " << sceneFile << endl;
+        return SCENE_FILE_ERROR;
+    }
+
+    size_t groups = scene.groupCount();
+    scene.groupWorld = scene.groupLocal;
+    scene.groupFlags.assign(groups, Scene::LOCAL_DIRTY);
+    scene.groupSubtreeEnd.resize(groups);
+    for (size_t g = 0; g < groups; g++) {
+        scene.groupSubtreeEnd[g] = (int) g + 1;
+    }
+    scene.instanceBounds.resize(scene.instanceCount());
+
+    for (const AnimationRecord& record : animations) {
+        int step;
+        if (record.curve) {
+            vector<Vertex> points(curvePoints.begin() + record.firstPoint,
+                                  curvePoints.begin() + record.firstPoint + record.pointCount);
+            step = scene.animations.addCurve(points, record.period, record.align != 0);
+        } else {
+            step = scene.animations.addRotation(record.period, record.axis[0], record.axis[1], record.axis[2]);
+        }
+        if (step < 0) {
+            cerr << "Compiled scene is damaged: " << sceneFile << endl;
+            return SCENE_FILE_ERROR;
+        }
+    }
+
+    window.width = header.windowWidth;
+    window.height = header.windowHeight;
+    const float* c = header.camera;
+    camera.setPosition(c[0], c[1], c[2]);
+    camera.setLookAt(c[3], c[4], c[5]);
+    camera.setUp(c[6], c[7], c[8]);
+    camera.setProjection(c[9], c[10], c[11]);
+
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    cout << "Compiled scene loaded: " << groups << " groups, " << scene.instanceCount() << " instances, "
+         << scene.modelFiles.size() << " model files in " << ms << " ms" << endl;
+    return SCENE_FILE_OK;
+}
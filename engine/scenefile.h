@@ -0,0 +1,39 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "camera.h"
+#include "parser.h"
+#include "scene.h"
+
+// Compiled scene (engine --compile world.xml world.scn): the window, the camera and
+// the flattened scene of a world XML file as fixed-size arrays in 16-byte aligned
+// sections. Loading maps the file and copies the arrays, nothing is parsed.
+// The file records the size and modification time of its XML source.
+enum SceneFileResult {
+    SCENE_FILE_OK,
+    SCENE_FILE_STALE, // The XML source changed since the scene was compiled
+    SCENE_FILE_ERROR
+};
+
+class SceneFile {
+public:
+    static const unsigned int VERSION = 1;
+
+    // Parse the XML file and write the compiled scene
+    static bool compile(const std::string& xmlFile, const std::string& sceneFile);
+
+    // Parse the XML file and build the compiled scene in memory
+    static bool compile(const std::string& xmlFile, std::vector<char>& data);
+
+    // Load a compiled scene. sourceFile is set to the XML it was compiled from,
+    // so a stale scene can be read from there instead.
+    static SceneFileResult load(const std::string& sceneFile, Window& window, Camera& camera, Scene& scene,
+                                std::string& sourceFile);
+
+    // Load a compiled scene already in memory (16-byte aligned), e.g. from an asset pack.
+    // The source is only checked when sourceFile is given.
+    static SceneFileResult load(const char* data, size_t size, const std::string& sceneFile, Window& window,
+                                Camera& camera, Scene& scene, std::string* sourceFile);
+
+    static bool isSceneFile(const std::string& filename);
+};
@@ -0,0 +1,357 @@
+#include "softrast.h"
+#include "image.h"
+#include "options.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+SoftwareRasterizer::SoftwareRasterizer(int w, int h, ThreadPool& threadPool)
+    : pool(threadPool), width(w), height(h), submittedTriangles(0) {
+    tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+    stride = tilesX * TILE_SIZE;
+
+    colorBuffer.resize((size_t) stride * tilesY * TILE_SIZE);
+    depthBuffer.resize((size_t) stride * tilesY * TILE_SIZE);
+    bins.resize(tilesX * tilesY);
+}
+
+void SoftwareRasterizer::render(const Scene& scene, const vector<ModelData>& models, const Camera& camera) {
+    Camera imageCamera = camera;
+    imageCamera.setAspect((float) width / height);
+    const Mat4& viewProj = imageCamera.getViewProjectionMatrix();
+
+    // Geometry stage: one task per instance
+    size_t instances = scene.instanceCount();
+    modelTriangles.resize(instances);
+    pool.parallelFor((int) instances, [&](int index, int) {
+        const ModelData& model = models[scene.instanceModel[index]];
+        modelTriangles[index].clear();
+        if (model.loaded) {
+            transformModel(model, viewProj * scene.instanceWorld(index), modelTriangles[index]);
+        }
+    });
+
+    submittedTriangles = 0;
+    triangles.clear();
+    for (size_t i = 0; i < instances; i++) {
+        const ModelData& model = models[scene.instanceModel[i]];
+        if (model.loaded) {
+            submittedTriangles += model.triangleCount();
+        }
+        triangles.insert(triangles.end(), modelTriangles[i].begin(), modelTriangles[i].end());
+    }
+
+    binTriangles();
+
+    // Raster stage: one task per tile, each tile also clears its own part of the buffers
+    pool.parallelFor(tilesX * tilesY, [this](int tile, int) {
+        rasterizeTile(tile);
+    });
+}
+
+void SoftwareRasterizer::transformModel(const ModelData& model, const Mat4& modelViewProj,
+                                        vector<ScreenTriangle>& out) const {
+    // Transform every vertex once, faces share them
+    vector<float> clip(model.vertices.size() * 4);
+    for (size_t i = 0; i < model.vertices.size(); i++) {
+        const Vertex& v = model.vertices[i];
+        modelViewProj.transformPoint(v.x, v.y, v.z, &clip[i * 4]);
+    }
+
+    size_t count = model.faces.empty() ? model.vertices.size() / 3 : model.faces.size();
+    for (size_t f = 0; f < count; f++) {
+        int index[3];
+        if (model.faces.empty()) {
+            index[0] = (int) (f * 3); index[1] = (int) (f * 3 + 1); index[2] = (int) (f * 3 + 2);
+        } else {
+            index[0] = model.faces[f].v1; index[1] = model.faces[f].v2; index[2] = model.faces[f].v3;
+        }
+
+        float tri[3][4];
+        for (int k = 0; k < 3; k++) {
+            for (int c = 0; c < 4; c++) tri[k][c] = clip[index[k] * 4 + c];
+        }
+
+        // Flat color baked into the draw buffer at load time
+        const DrawVertex& first = model.drawVertices[f * 3];
+        uint32_t color = first.r | (first.g << 8) | (first.b << 16) | ((uint32_t) first.a << 24);
+        clipAndSetup(tri, color, out);
+    }
+}
+
+// Clip against the near plane (z > -w) and convert the result to screen space
+void SoftwareRasterizer::clipAndSetup(const float clip[3][4], uint32_t color,
+                                      vector<ScreenTriangle>& out) const {
+    // Trivial reject when all vertices are outside the same frustum plane
+    for (int axis = 0; axis < 3; axis++) {
+        bool allBelow = true, allAbove = true;
+        for (int k = 0; k < 3; k++) {
+            if (clip[k][axis] >= -clip[k][3]) allBelow = false;
+            if (clip[k][axis] <= clip[k][3]) allAbove = false;
+        }
+        if (allBelow || allAbove) return;
+    }
+
+    // Sutherland-Hodgman against the near plane, at most 4 vertices come out
+    float polygon[4][4];
+    int count = 0;
+    for (int k = 0; k < 3; k++) {
+        const float* a = clip[k];
+        const float* b = clip[(k + 1) % 3];
+        float da = a[2] + a[3];
+        float db = b[2] + b[3];
+
+        if (da >= 0) {
+            for (int c = 0; c < 4; c++) polygon[count][c] = a[c];
+            count++;
+        }
+        if ((da >= 0) != (db >= 0)) {
+            float t = da / (da - db);
+            for (int c = 0; c < 4; c++) polygon[count][c] = a[c] + t * (b[c] - a[c]);
+            count++;
+        }
+    }
+    if (count < 3) return;
+
+    // Perspective divide and viewport transform (y points down in the image)
+    float screen[4][3];
+    for (int k = 0; k < count; k++) {
+        float invW = 1.0f / polygon[k][3];
+        screen[k][0] = (polygon[k][0] * invW * 0.5f + 0.5f) * width;
+        screen[k][1] = (0.5f - polygon[k][1] * invW * 0.5f) * height;
+        screen[k][2] = polygon[k][2] * invW * 0.5f + 0.5f;
+    }
+
+    float tri[3][3];
+    for (int k = 1; k + 1 < count; k++) {
+        for (int c = 0; c < 3; c++) {
+            tri[0][c] = screen[0][c];
+            tri[1][c] = screen[k][c];
+            tri[2][c] = screen[k + 1][c];
+        }
+        setupTriangle(tri, color, out);
+    }
+}
+
+void SoftwareRasterizer::setupTriangle(const float v[3][3], uint32_t color,
+                                       vector<ScreenTriangle>& out) const {
+    float area = (v[1][0] - v[0][0]) * (v[2][1] - v[0][1]) - (v[2][0] - v[0][0]) * (v[1][1] - v[0][1]);
+    if (area == 0.0f) return;
+
+    // Clamp in float first, vertices close to the near plane can land far off screen
+    float minX = min({v[0][0], v[1][0], v[2][0]}), maxX = max({v[0][0], v[1][0], v[2][0]});
+    float minY = min({v[0][1], v[1][1], v[2][1]}), maxY = max({v[0][1], v[1][1], v[2][1]});
+    if (maxX < 0.0f || maxY < 0.0f || minX >= width || minY >= height) return;
+
+    ScreenTriangle t;
+    t.minX = (int) max(minX, 0.0f);
+    t.minY = (int) max(minY, 0.0f);
+    t.maxX = (int) min(maxX, (float) (width - 1));
+    t.maxY = (int) min(maxY, (float) (height - 1));
+
+    // Face culling is disabled in the OpenGL path, so both windings are accepted
+    float sign = area > 0 ? 1.0f : -1.0f;
+    for (int e = 0; e < 3; e++) {
+        const float* a = v[(e + 1) % 3];
+        const float* b = v[(e + 2) % 3];
+        t.edgeA[e] = sign * (a[1] - b[1]);
+        t.edgeB[e] = sign * (b[0] - a[0]);
+        t.edgeC[e] = sign * (a[0] * b[1] - b[0] * a[1]);
+    }
+
+    // Edge e is the barycentric weight of vertex e (scaled by the area)
+    float invArea = sign / area;
+    t.depthA = (v[0][2] * t.edgeA[0] + v[1][2] * t.edgeA[1] + v[2][2] * t.edgeA[2]) * invArea;
+    t.depthB = (v[0][2] * t.edgeB[0] + v[1][2] * t.edgeB[1] + v[2][2] * t.edgeB[2]) * invArea;
+    t.depthC = (v[0][2] * t.edgeC[0] + v[1][2] * t.edgeC[1] + v[2][2] * t.edgeC[2]) * invArea;
+    t.color = color;
+
+    out.push_back(t);
+}
+
+void SoftwareRasterizer::binTriangles() {
+    for (vector<int>& bin : bins) bin.clear();
+
+    for (size_t i = 0; i < triangles.size(); i++) {
+        const ScreenTriangle& t = triangles[i];
+        for (int ty = t.minY / TILE_SIZE; ty <= t.maxY / TILE_SIZE; ty++) {
+            for (int tx = t.minX / TILE_SIZE; tx <= t.maxX / TILE_SIZE; tx++) {
+                bins[ty * tilesX + tx].push_back((int) i);
+            }
+        }
+    }
+}
+
+void SoftwareRasterizer::rasterizeTile(int tile) {
+    int tileX = (tile % tilesX) * TILE_SIZE;
+    int tileY = (tile / tilesX) * TILE_SIZE;
+
+    for (int y = tileY; y < tileY + TILE_SIZE; y++) {
+        size_t row = (size_t) y * stride + tileX;
+        fill(colorBuffer.begin() + row, colorBuffer.begin() + row + TILE_SIZE, 0xFF000000);
+        fill(depthBuffer.begin() + row, depthBuffer.begin() + row + TILE_SIZE, 1.0f);
+    }
+
+    for (int index : bins[tile]) {
+        const ScreenTriangle& t = triangles[index];
+
+        // Bounding box inside this tile, x aligned to groups of 4 pixels
+        int x0 = max(t.minX, tileX) & ~3;
+        int x1 = min(t.maxX, tileX + TILE_SIZE - 1);
+        int y0 = max(t.minY, tileY);
+        int y1 = min(t.maxY, tileY + TILE_SIZE - 1);
+
+#ifdef __SSE2__
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+        const __m128 a0 = _mm_set1_ps(t.edgeA[0]), a1 = _mm_set1_ps(t.edgeA[1]), a2 = _mm_set1_ps(t.edgeA[2]);
+        const __m128 depthA = _mm_set1_ps(t.depthA);
+        const __m128i color = _mm_set1_epi32((int) t.color);
+
+        for (int y = y0; y <= y1; y++) {
+            float py = y + 0.5f;
+            __m128 row0 = _mm_set1_ps(t.edgeB[0] * py + t.edgeC[0]);
+            __m128 row1 = _mm_set1_ps(t.edgeB[1] * py + t.edgeC[1]);
+            __m128 row2 = _mm_set1_ps(t.edgeB[2] * py + t.edgeC[2]);
+            __m128 depthRow = _mm_set1_ps(t.depthB * py + t.depthC);
+
+            for (int x = x0; x <= x1; x += 4) {
+                __m128 px = _mm_add_ps(_mm_set1_ps((float) x), offsets);
+                __m128 e0 = _mm_add_ps(_mm_mul_ps(a0, px), row0);
+                __m128 e1 = _mm_add_ps(_mm_mul_ps(a1, px), row1);
+                __m128 e2 = _mm_add_ps(_mm_mul_ps(a2, px), row2);
+                __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)),
+                                           _mm_cmpge_ps(e2, zero));
+                if (_mm_movemask_ps(inside) == 0) continue;
+
+                size_t offset = (size_t) y * stride + x;
+                __m128 z = _mm_add_ps(_mm_mul_ps(depthA, px), depthRow);
+                __m128 oldZ = _mm_loadu_ps(&depthBuffer[offset]);
+                __m128 pass = _mm_and_ps(inside, _mm_cmplt_ps(z, oldZ));
+                if (_mm_movemask_ps(pass) == 0) continue;
+
+                _mm_storeu_ps(&depthBuffer[offset], _mm_or_ps(_mm_and_ps(pass, z), _mm_andnot_ps(pass, oldZ)));
+
+                __m128i passMask = _mm_castps_si128(pass);
+                __m128i* colorPtr = (__m128i*) &colorBuffer[offset];
+                __m128i oldColor = _mm_loadu_si128(colorPtr);
+                _mm_storeu_si128(colorPtr, _mm_or_si128(_mm_and_si128(passMask, color),
+                                                        _mm_andnot_si128(passMask, oldColor)));
+            }
+        }
+#else
+        for (int y = y0; y <= y1; y++) {
+            float py = y + 0.5f;
+            for (int x = x0; x <= x1; x++) {
+                float px = x + 0.5f;
+                if (t.edgeA[0] * px + t.edgeB[0] * py + t.edgeC[0] < 0) continue;
+                if (t.edgeA[1] * px + t.edgeB[1] * py + t.edgeC[1] < 0) continue;
+                if (t.edgeA[2] * px + t.edgeB[2] * py + t.edgeC[2] < 0) continue;
+
+                size_t offset = (size_t) y * stride + x;
+                float z = t.depthA * px + t.depthB * py + t.depthC;
+                if (z < depthBuffer[offset]) {
+                    depthBuffer[offset] = z;
+                    colorBuffer[offset] = t.color;
+                }
+            }
+        }
+#endif
+    }
+}
+
+bool SoftwareRasterizer::saveImage(const string& filename) const {
+    vector<unsigned char> rgb((size_t) width * height * 3);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            uint32_t c = colorBuffer[(size_t) y * stride + x];
+            unsigned char* out = &rgb[((size_t) y * width + x) * 3];
+            out[0] = c & 0xFF;
+            out[1] = (c >> 8) & 0xFF;
+            out[2] = (c >> 16) & 0xFF;
+        }
+    }
+    return writeImage(filename, width, height, rgb.data());
+}
+
+// Render the orbit benchmark once per thread count and report throughput
+static int benchmarkSoftware(const EngineOptions& options, const Scene& scene, const vector<ModelData>& models,
+                             Camera& camera, int width, int height) {
+    int maxThreads = options.threads > 0 ? options.threads : (int) thread::hardware_concurrency();
+    if (maxThreads <= 0) maxThreads = 1;
+
+    vector<int> threadCounts;
+    for (int t = 1; t < maxThreads; t *= 2) threadCounts.push_back(t);
+    threadCounts.push_back(maxThreads);
+
+    float alpha = camera.getAlpha(), beta = camera.getBeta(), radius = camera.getRadius();
+
+    FILE* csv = fopen(options.bench.csvFile.c_str(), "w");
+    if (csv) fprintf(csv, "threads,avg_ms,p95_ms,mpixels_per_s,mtriangles_per_s\n");
+
+    cout << "\n--- Software rasterizer benchmark (" << width << "x" << height << ", "
+         << options.bench.frames << " frames) ---" << endl;
+    printf("%8s %10s %10s %12s %14s\n", "threads", "avg ms", "p95 ms", "Mpixels/s", "Mtriangles/s");
+
+    for (int threads : threadCounts) {
+        ThreadPool pool(threads);
+        SoftwareRasterizer rasterizer(width, height, pool);
+
+        // Every run starts from the same viewpoint
+        camera.setSpherical(alpha, beta, radius);
+        Benchmark benchmark;
+        benchmark.begin(options.bench, &camera);
+
+        do {
+            benchmark.prepareFrame();
+            rasterizer.render(scene, models, camera);
+        } while (benchmark.endFrame());
+
+        double averageMs = benchmark.averageFrameMs();
+        double mpixels = (double) width * height / (averageMs * 1000.0);
+        double mtriangles = rasterizer.getSubmittedTriangles() / (averageMs * 1000.0);
+        printf("%8d %10.3f %10.3f %12.2f %14.3f\n", threads, averageMs, benchmark.percentileMs(95),
+               mpixels, mtriangles);
+        if (csv) {
+            fprintf(csv, "%d,%f,%f,%f,%f\n", threads, averageMs, benchmark.percentileMs(95), mpixels, mtriangles);
+        }
+    }
+
+    if (csv) {
+        fclose(csv);
+        cout << "Results written to " << options.bench.csvFile << endl;
+    }
+    return 0;
+}
+
+int runSoftwareBackend(const EngineOptions& options, const Scene& scene, const vector<ModelData>& models,
+                       Camera& camera, int width, int height) {
+    if (options.bench.enabled) {
+        return benchmarkSoftware(options, scene, models, camera, width, height);
+    }
+
+    ThreadPool pool(options.threads);
+    SoftwareRasterizer rasterizer(width, height, pool);
+
+    auto start = chrono::steady_clock::now();
+    rasterizer.render(scene, models, camera);
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    cout << "Software render: " << rasterizer.getSubmittedTriangles() << " triangles in " << ms
+         << " ms using " << pool.size() << " threads" << endl;
+
+    if (!rasterizer.saveImage(options.outputFile)) {
+        cerr << "Error writing image: " << options.outputFile << endl;
+        return 1;
+    }
+    cout << "Image written to " << options.outputFile << endl;
+    return 0;
+}
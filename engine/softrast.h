@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "camera.h"
+#include "matrix.h"
+#include "model.h"
+#include "scene.h"
+#include "threadpool.h"
+
+struct EngineOptions;
+
+// Tiled CPU rasterizer: triangles are transformed, binned into screen tiles and
+// the tiles are rasterized in parallel with SIMD edge functions and a depth buffer
+class SoftwareRasterizer {
+public:
+    static const int TILE_SIZE = 64;
+
+    SoftwareRasterizer(int width, int height, ThreadPool& pool);
+
+    // Render the scene instances as seen from the camera (models holds the loaded model of each file)
+    void render(const Scene& scene, const std::vector<ModelData>& models, const Camera& camera);
+
+    // Save the color buffer (.ppm or .png)
+    bool saveImage(const std::string& filename) const;
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+    // Statistics of the last frame
+    long getSubmittedTriangles() const { return submittedTriangles; }
+    long getRasterizedTriangles() const { return (long) triangles.size(); }
+
+private:
+    // Triangle in screen space, ready for rasterization
+    struct ScreenTriangle {
+        float edgeA[3], edgeB[3], edgeC[3]; // Edge functions E(x, y) = A*x + B*y + C
+        float depthA, depthB, depthC;       // Depth plane z(x, y) = A*x + B*y + C
+        int minX, minY, maxX, maxY;         // Bounding box in pixels (inclusive)
+        uint32_t color;
+    };
+
+    void transformModel(const ModelData& model, const Mat4& modelViewProj, std::vector<ScreenTriangle>& out) const;
+    void clipAndSetup(const float clip[3][4], uint32_t color, std::vector<ScreenTriangle>& out) const;
+    void setupTriangle(const float screen[3][3], uint32_t color, std::vector<ScreenTriangle>& out) const;
+    void binTriangles();
+    void rasterizeTile(int tile);
+
+    ThreadPool& pool;
+    int width, height;
+    int tilesX, tilesY;
+    int stride; // Framebuffer row length, padded to whole tiles
+
+    std::vector<uint32_t> colorBuffer; // RGBA8, rows top to bottom
+    std::vector<float> depthBuffer;
+
+    std::vector<std::vector<ScreenTriangle>> modelTriangles; // Per-instance output of the geometry stage
+    std::vector<ScreenTriangle> triangles;
+    std::vector<std::vector<int>> bins; // Triangle indices per tile, in submission order
+    long submittedTriangles;
+};
+
+// Render the scene without OpenGL, either one image or a benchmark over core counts
+int runSoftwareBackend(const EngineOptions& options, const Scene& scene, const std::vector<ModelData>& models,
+                       Camera& camera, int width, int height);
@@ -0,0 +1,182 @@
+#include "streaming.h"
+#include <algorithm>
+#include <math.h>
+
+using namespace std;
+
+// Distance from a point to a box, 0 inside it
+static float boxDistance(const Bounds& bounds, const float point[3]) {
+    float squared = 0.0f;
+    for (int axis = 0; axis < 3; axis++) {
+        float d = max(max(bounds.min[axis] - point[axis], point[axis] - bounds.max[axis]), 0.0f);
+        squared += d * d;
+    }
+    return sqrtf(squared);
+}
+
+ModelStreamer::ModelStreamer(Scene& scene, ResourceManager& resources)
+    : scene(scene), resources(resources), keepUnreferenced(false), pendingModels(0), loading(-1), stopping(false) {}
+
+ModelStreamer::~ModelStreamer() {
+    if (!loader.joinable()) return;
+
+    {
+        lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    loader.join();
+}
+
+void ModelStreamer::start(const StreamingConfig& streamingConfig, bool keepModels, UploadFunction uploadFunction) {
+    config = streamingConfig;
+    keepUnreferenced = keepModels;
+    upload = uploadFunction;
+    instanceNear.assign(scene.instanceCount(), 0);
+    modelPriority.assign(resources.size(), 0.0f);
+    modelFailed.assign(resources.size(), 0);
+    loader = thread(&ModelStreamer::loaderLoop, this);
+}
+
+// Take references for the instances that came within the radius, drop those that
+// left it by more than the margin, and score the wanted models
+void ModelStreamer::referenceNearby(const Camera& camera) {
+    const float position[3] = {camera.getPosX(), camera.getPosY(), camera.getPosZ()};
+    float view[3] = {camera.getLookAtX() - position[0], camera.getLookAtY() - position[1],
+                     camera.getLookAtZ() - position[2]};
+    float length = sqrtf(view[0] * view[0] + view[1] * view[1] + view[2] * view[2]);
+    for (int axis = 0; axis < 3; axis++) {
+        view[axis] = length > 0.0f ? view[axis] / length : 0.0f;
+    }
+
+    fill(modelPriority.begin(), modelPriority.end(), INFINITY);
+    for (size_t i = 0; i < scene.instanceCount(); i++) {
+        const Bounds& bounds = scene.instanceBounds[i];
+        int model = scene.instanceModel[i];
+        float distance = boxDistance(bounds, position);
+
+        if (!instanceNear[i] && distance <= config.radius) {
+            instanceNear[i] = 1;
+            resources.addRef(model);
+        } else if (instanceNear[i] && distance > config.radius + config.margin) {
+            instanceNear[i] = 0;
+            resources.release(model);
+        }
+        if (!instanceNear[i]) continue;
+
+        // Ahead of the camera counts once the distance, beside it twice, behind it three times
+        float toCenter[3], centerDistance = 0.0f;
+        for (int axis = 0; axis < 3; axis++) {
+            toCenter[axis] = (bounds.min[axis] + bounds.max[axis]) * 0.5f - position[axis];
+            centerDistance += toCenter[axis] * toCenter[axis];
+        }
+        centerDistance = sqrtf(centerDistance);
+        float facing = centerDistance > 0.0f
+                           ? (toCenter[0] * view[0] + toCenter[1] * view[1] + toCenter[2] * view[2]) / centerDistance
+                           : 1.0f;
+        modelPriority[model] = min(modelPriority[model], distance * (2.0f - facing));
+    }
+}
+
+void ModelStreamer::preload(const Camera& camera) {
+    referenceNearby(camera);
+    for (size_t model = 0; model < resources.size(); model++) {
+        if (resources.refCount((int) model) == 0) continue;
+        if (resources.load((int) model)) {
+            scene.updateModelBounds((int) model, resources.models());
+        } else {
+            modelFailed[model] = 1;
+        }
+    }
+}
+
+void ModelStreamer::update(const Camera& camera) {
+    referenceNearby(camera);
+
+    // Models that lost their last user leave memory, unless a budget lets them stay cached
+    if (keepUnreferenced) {
+        resources.enforceBudget();
+    } else {
+        resources.evictUnreferenced();
+    }
+
+    vector<pair<int, ModelData>> done;
+    vector<pair<float, int>> wanted;
+    vector<pair<float, int>> uploads;
+    {
+        lock_guard<std::mutex> lock(mutex);
+        done.swap(finished);
+    }
+
+    // Move the models read since the last frame in; their instances get real bounds
+    vector<ModelData>& models = resources.models();
+    for (pair<int, ModelData>& result : done) {
+        int model = result.first;
+        if (!result.second.loaded) {
+            modelFailed[model] = 1;
+            continue;
+        }
+        resources.install(model, result.second);
+        scene.updateModelBounds(model, models);
+    }
+
+    // Wanted models are read if they are not resident, uploaded if they are
+    pendingModels = 0;
+    for (size_t model = 0; model < models.size(); model++) {
+        if (modelPriority[model] == INFINITY || modelFailed[model]) continue;
+        if (!models[model].loaded) {
+            wanted.push_back({modelPriority[model], (int) model});
+            pendingModels++;
+        } else if (!models[model].drawBuffer) {
+            uploads.push_back({modelPriority[model], (int) model});
+            pendingModels++;
+        }
+    }
+
+    // The loader takes the best request each time, the list replaces the old one so
+    // models that are no longer wanted drop out
+    {
+        lock_guard<std::mutex> lock(mutex);
+        requests.clear();
+        for (const pair<float, int>& request : wanted) {
+            bool read = request.second == loading;
+            for (const pair<int, ModelData>& result : finished) {
+                read = read || result.first == request.second;
+            }
+            if (!read) requests.push_back(request);
+        }
+    }
+    wake.notify_one();
+
+    sort(uploads.begin(), uploads.end());
+    size_t uploaded = 0;
+    for (const pair<float, int>& request : uploads) {
+        if (uploaded > 0 && uploaded >= config.uploadBudget) break;
+        uploaded += upload(request.second);
+        pendingModels--;
+    }
+}
+
+void ModelStreamer::loaderLoop() {
+    while (true) {
+        int model;
+        {
+            unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || !requests.empty(); });
+            if (stopping) break;
+
+            auto best = min_element(requests.begin(), requests.end());
+            model = best->second;
+            requests.erase(best);
+            loading = model;
+        }
+
+        // Only this read runs off the main thread
+        pair<int, ModelData> result(model, ModelData());
+        resources.read(model, result.second);
+
+        lock_guard<std::mutex> lock(mutex);
+        finished.push_back(move(result));
+        loading = -1;
+    }
+}
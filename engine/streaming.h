@@ -0,0 +1,69 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "camera.h"
+#include "resources.h"
+#include "scene.h"
+
+// Streaming parameters (--stream RADIUS [--stream-margin M] [--upload-budget KB])
+struct StreamingConfig {
+    float radius;        // Instances closer than this to the camera want their model
+    float margin;        // ...and keep it until they are this much further away
+    size_t uploadBudget; // Bytes uploaded to the GPU per frame (at least one model)
+
+    StreamingConfig() : radius(0.0f), margin(0.0f), uploadBudget(1 << 20) {}
+    bool enabled() const { return radius > 0.0f; }
+};
+
+// Loads the models of the instances near the camera and lets the far ones go.
+// An instance within the radius holds a reference on its model; the model files
+// are read on a background thread, nearest and most in front of the camera first,
+// installed between frames and uploaded within the per-frame budget. Models nobody
+// references any more are evicted (or kept while they fit the memory budget).
+class ModelStreamer {
+public:
+    // Uploads a resident model to the GPU, returns the bytes sent
+    typedef std::function<size_t(int model)> UploadFunction;
+
+    ModelStreamer(Scene& scene, ResourceManager& resources);
+    ~ModelStreamer();
+
+    void start(const StreamingConfig& config, bool keepUnreferenced, UploadFunction upload);
+
+    // Load the models around the camera before the first frame, on this thread
+    void preload(const Camera& camera);
+
+    // Called between frames, while nothing else reads the scene or the models
+    void update(const Camera& camera);
+
+    // Models wanted but not drawable yet
+    int pending() const { return pendingModels; }
+
+private:
+    void referenceNearby(const Camera& camera);
+    void loaderLoop();
+
+    Scene& scene;
+    ResourceManager& resources;
+    StreamingConfig config;
+    bool keepUnreferenced;
+    UploadFunction upload;
+
+    std::vector<unsigned char> instanceNear; // Holds a reference on its model
+    std::vector<float> modelPriority;        // Lowest instance score this frame, lower loads first
+    std::vector<unsigned char> modelFailed;
+    int pendingModels;
+
+    // Shared with the loader thread
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<std::pair<float, int>> requests; // Priority and model, rebuilt every frame
+    int loading;                                 // Model being read, -1 if none
+    std::vector<std::pair<int, ModelData>> finished;
+    bool stopping;
+    std::thread loader;
+};
@@ -0,0 +1,79 @@
+#include "threadpool.h"
+
+using namespace std;
+
+ThreadPool::ThreadPool(int threadCount)
+    : currentTask(nullptr), taskCount(0), nextIndex(0), busyWorkers(0), generation(0), stopping(false) {
+    if (threadCount <= 0) {
+        threadCount = (int) thread::hardware_concurrency();
+        if (threadCount <= 0) threadCount = 1;
+    }
+
+    // The calling thread is worker 0, so only threadCount - 1 threads are created
+    for (int i = 1; i < threadCount; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> lock(poolMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (thread& worker : workers) worker.join();
+}
+
+void ThreadPool::parallelFor(int count, const function<void(int, int)>& task) {
+    if (count <= 0) return;
+
+    // Nothing to share with a single thread
+    if (workers.empty()) {
+        for (int i = 0; i < count; i++) task(i, 0);
+        return;
+    }
+
+    {
+        lock_guard<mutex> lock(poolMutex);
+        currentTask = &task;
+        taskCount = count;
+        nextIndex = 0;
+        busyWorkers = (int) workers.size();
+        generation++;
+    }
+    wake.notify_all();
+
+    runTasks(0);
+
+    unique_lock<mutex> lock(poolMutex);
+    done.wait(lock, [this] { return busyWorkers == 0; });
+    currentTask = nullptr;
+}
+
+void ThreadPool::runTasks(int worker) {
+    // Indices are handed out one at a time so uneven tasks balance themselves
+    int index;
+    while ((index = nextIndex.fetch_add(1)) < taskCount) {
+        (*currentTask)(index, worker);
+    }
+}
+
+void ThreadPool::workerLoop(int worker) {
+    long seenGeneration = 0;
+    while (true) {
+        {
+            unique_lock<mutex> lock(poolMutex);
+            wake.wait(lock, [&] { return stopping || generation != seenGeneration; });
+            if (stopping) return;
+            seenGeneration = generation;
+        }
+
+        runTasks(worker);
+
+        {
+            lock_guard<mutex> lock(poolMutex);
+            busyWorkers--;
+        }
+        done.notify_one();
+    }
+}
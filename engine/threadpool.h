@@ -0,0 +1,37 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that split index ranges between them
+class ThreadPool {
+public:
+    // threadCount = 0 uses one thread per hardware thread
+    explicit ThreadPool(int threadCount = 0);
+    ~ThreadPool();
+
+    int size() const { return (int) workers.size() + 1; }
+
+    // Run task(index, worker) for every index in [0, count) and wait for all of them.
+    // The calling thread takes part as worker 0.
+    void parallelFor(int count, const std::function<void(int, int)>& task);
+
+private:
+    void workerLoop(int worker);
+    void runTasks(int worker);
+
+    std::vector<std::thread> workers;
+    std::mutex poolMutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+
+    const std::function<void(int, int)>* currentTask;
+    int taskCount;
+    std::atomic<int> nextIndex;
+    int busyWorkers;
+    long generation;
+    bool stopping;
+};
@@ -32,6 +32,22 @@ distribution.
 #   include <cstdarg>
 #endif
 
+// std::from_chars / std::to_chars for the number conversions where the standard
+// library has them for floating point too; sscanf / snprintf otherwise
+#if __cplusplus >= 201703L && defined(__has_include)
+#   if __has_include(<charconv>)
+#       include <charconv>
+#   endif
+#endif
+#if defined(__cpp_lib_to_chars)
+#   define TIXML_CHARCONV
+#endif
+
+// Huge page backed pool blocks
+#if defined(__linux__)
+#   include <sys/mman.h>
+#endif
+
 #if defined(_MSC_VER) && (_MSC_VER >= 1400 ) && (!defined WINCE)
 	// Microsoft Visual Studio, version 2005 and higher. Not WinCE.
 	/*int _snprintf_s(
@@ -154,6 +170,48 @@ static const Entity entities[NUM_ENTITIES] = {
 };
 
 
+void* MemPool::AllocBlock( size_t size, bool* hugePages )
+{
+#if defined(__linux__)
+    if ( *hugePages ) {
+        void* block = MAP_FAILED;
+#ifdef MAP_HUGETLB
+        block = mmap( 0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0 );
+#endif
+        if ( block == MAP_FAILED ) {
+            // No huge pages reserved: ask for transparent ones
+            block = mmap( 0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+#ifdef MADV_HUGEPAGE
+            if ( block != MAP_FAILED ) {
+                madvise( block, size, MADV_HUGEPAGE );
+            }
+#endif
+        }
+        if ( block != MAP_FAILED ) {
+            return block;
+        }
+    }
+#endif
+    *hugePages = false;
+    return new char[size];
+}
+
+
+void MemPool::FreeBlock( void* block, size_t size, bool hugePages )
+{
+#if defined(__linux__)
+    if ( hugePages ) {
+        munmap( block, size );
+        return;
+    }
+#else
+    (void)size;
+    (void)hugePages;
+#endif
+    delete [] static_cast<char*>( block );
+}
+
+
 StrPair::~StrPair()
 {
     Reset();
@@ -213,12 +271,23 @@ char* StrPair::ParseText( char* p, const char* endTag, int strFlags, int* curLin
 {
     TIXMLASSERT( p );
     TIXMLASSERT( endTag && *endTag );
-	TIXMLASSERT(curLineNumPtr);
 
     char* start = p;
     const char  endChar = *endTag;
     size_t length = strlen( endTag );
 
+    // Without line counting, jump from one end character to the next.
+    if ( !curLineNumPtr ) {
+        while ( ( p = strchr( p, endChar ) ) != 0 ) {
+            if ( strncmp( p, endTag, length ) == 0 ) {
+                Set( start, p, strFlags );
+                return p + length;
+            }
+            ++p;
+        }
+        return 0;
+    }
+
     // Inner loop of text parsing.
     while ( *p ) {
         if ( *p == endChar && strncmp( p, endTag, length ) == 0 ) {
@@ -568,14 +637,124 @@ const char* XMLUtil::GetCharacterRef( const char* p, char* value, int* length )
 }
 
 
+#ifdef TIXML_CHARCONV
+/*
+	The conversions below first try std::from_chars / std::to_chars, which need no
+	format string or locale. They give the same results as the sscanf / snprintf
+	formats they replace; any input they do not take as is (hex, "inf", "nan",
+	out of range values, a short buffer...) goes to sscanf / snprintf as before,
+	so the error semantics do not change.
+*/
+
+// Where from_chars should start reading a decimal number, or null if the text does
+// not start with one the way sscanf would see it. Like sscanf, white space and a
+// '+' sign are skipped.
+static const char* DecimalNumberStart( const char* str, bool allowMinus, bool allowDot )
+{
+    while ( isspace( static_cast<unsigned char>( *str ) ) ) {
+        ++str;
+    }
+    const char* p = str;
+    if ( *p == '+' ) {
+        str = ++p;
+    }
+    else if ( *p == '-' && allowMinus ) {
+        ++p;
+    }
+    if ( !isdigit( static_cast<unsigned char>( *p ) ) && !( allowDot && *p == '.' ) ) {
+        return 0;
+    }
+    if ( *p == '0' && ( *(p + 1) == 'x' || *(p + 1) == 'X' ) ) {
+        return 0;
+    }
+    return str;
+}
+
+template <typename T>
+static bool FromCharsInteger( const char* str, T* value, bool allowMinus )
+{
+    const char* start = DecimalNumberStart( str, allowMinus, false );
+    if ( !start ) {
+        return false;
+    }
+    T v = 0;
+    const std::from_chars_result result = std::from_chars( start, start + strlen( start ), v );
+    if ( result.ec != std::errc() ) {
+        return false;
+    }
+    *value = v;
+    return true;
+}
+
+template <typename T>
+static bool FromCharsFloat( const char* str, T* value )
+{
+    const char* start = DecimalNumberStart( str, true, true );
+    if ( !start ) {
+        return false;
+    }
+    T v = 0;
+    const std::from_chars_result result = std::from_chars( start, start + strlen( start ), v );
+    if ( result.ec != std::errc() ) {
+        return false;
+    }
+    // from_chars stops before an exponent without digits ("1e", "2E+"), sscanf rejects it
+    if ( *result.ptr == 'e' || *result.ptr == 'E' ) {
+        return false;
+    }
+    *value = v;
+    return true;
+}
+
+template <typename T>
+static bool ToCharsStr( T v, char* buffer, int bufferSize )
+{
+    if ( bufferSize <= 0 ) {
+        return false;
+    }
+    const std::to_chars_result result = std::to_chars( buffer, buffer + bufferSize - 1, v );
+    if ( result.ec != std::errc() ) {
+        return false;
+    }
+    *result.ptr = 0;
+    return true;
+}
+
+// to_chars with a precision formats like printf "%.<precision>g"
+template <typename T>
+static bool ToCharsStr( T v, char* buffer, int bufferSize, int precision )
+{
+    if ( bufferSize <= 0 ) {
+        return false;
+    }
+    const std::to_chars_result result = std::to_chars( buffer, buffer + bufferSize - 1, v, std::chars_format::general, precision );
+    if ( result.ec != std::errc() ) {
+        return false;
+    }
+    *result.ptr = 0;
+    return true;
+}
+#endif
+
+
 void XMLUtil::ToStr( int v, char* buffer, int bufferSize )
 {
+#ifdef TIXML_CHARCONV
+    if ( ToCharsStr( v, buffer, bufferSize ) ) {
+        return;
+    }
+#endif
     TIXML_SNPRINTF( buffer, bufferSize, "%d", v );
 }
 
 
 void XMLUtil::ToStr( unsigned v, char* buffer, int bufferSize )
 {
+#ifdef TIXML_CHARCONV
+    if ( ToCharsStr( v, buffer, bufferSize ) ) {
+        return;
+    }
+#endif
     TIXML_SNPRINTF( buffer, bufferSize, "%u", v );
 }
 
@@ -591,24 +770,44 @@ void XMLUtil::ToStr( bool v, char* buffer, int bufferSize )
 */
 void XMLUtil::ToStr( float v, char* buffer, int bufferSize )
 {
+#ifdef TIXML_CHARCONV
+    if ( ToCharsStr( v, buffer, bufferSize, 8 ) ) {
+        return;
+    }
+#endif
     TIXML_SNPRINTF( buffer, bufferSize, "%.8g", v );
 }
 
 
 void XMLUtil::ToStr( double v, char* buffer, int bufferSize )
 {
+#ifdef TIXML_CHARCONV
+    if ( ToCharsStr( v, buffer, bufferSize, 17 ) ) {
+        return;
+    }
+#endif
     TIXML_SNPRINTF( buffer, bufferSize, "%.17g", v );
 }
 
 
 void XMLUtil::ToStr( int64_t v, char* buffer, int bufferSize )
 {
+#ifdef TIXML_CHARCONV
+    if ( ToCharsStr( v, buffer, bufferSize ) ) {
+        return;
+    }
+#endif
 	// horrible syntax trick to make the compiler happy about %lld
 	TIXML_SNPRINTF(buffer, bufferSize, "%lld", static_cast<long long>(v));
 }
 
 void XMLUtil::ToStr( uint64_t v, char* buffer, int bufferSize )
 {
+#ifdef TIXML_CHARCONV
+    if ( ToCharsStr( v, buffer, bufferSize ) ) {
+        return;
+    }
+#endif
     // horrible syntax trick to make the compiler happy about %llu
     TIXML_SNPRINTF(buffer, bufferSize, "%llu", (long long)v);
 }
@@ -623,6 +822,11 @@ bool XMLUtil::ToInt(const char* str, int* value)
         }
     }
     else {
+#ifdef TIXML_CHARCONV
+        if (FromCharsInteger(str, value, true)) {
+            return true;
+        }
+#endif
         if (TIXML_SSCANF(str, "%d", value) == 1) {
             return true;
         }
@@ -632,6 +836,11 @@ bool XMLUtil::ToInt(const char* str, int* value)
 
 bool XMLUtil::ToUnsigned(const char* str, unsigned* value)
 {
+#ifdef TIXML_CHARCONV
+    if (FromCharsInteger(str, value, false)) {
+        return true;
+    }
+#endif
     if (TIXML_SSCANF(str, IsPrefixHex(str) ? "%x" : "%u", value) == 1) {
         return true;
     }
@@ -666,6 +875,11 @@ bool XMLUtil::ToBool( const char* str, bool* value )
 
 bool XMLUtil::ToFloat( const char* str, float* value )
 {
+#ifdef TIXML_CHARCONV
+    if ( FromCharsFloat( str, value ) ) {
+        return true;
+    }
+#endif
     if ( TIXML_SSCANF( str, "%f", value ) == 1 ) {
         return true;
     }
@@ -675,6 +889,11 @@ bool XMLUtil::ToFloat( const char* str, float* value )
 
 bool XMLUtil::ToDouble( const char* str, double* value )
 {
+#ifdef TIXML_CHARCONV
+    if ( FromCharsFloat( str, value ) ) {
+        return true;
+    }
+#endif
     if ( TIXML_SSCANF( str, "%lf", value ) == 1 ) {
         return true;
     }
@@ -692,6 +911,11 @@ bool XMLUtil::ToInt64(const char* str, int64_t* value)
         }
     }
     else {
+#ifdef TIXML_CHARCONV
+        if (FromCharsInteger(str, value, true)) {
+            return true;
+        }
+#endif
         long long v = 0;	// horrible syntax trick to make the compiler happy about %lld
         if (TIXML_SSCANF(str, "%lld", &v) == 1) {
             *value = static_cast<int64_t>(v);
@@ -703,6 +927,11 @@ bool XMLUtil::ToInt64(const char* str, int64_t* value)
 
 
 bool XMLUtil::ToUnsigned64(const char* str, uint64_t* value) {
+#ifdef TIXML_CHARCONV
+    if (FromCharsInteger(str, value, false)) {
+        return true;
+    }
+#endif
     unsigned long long v = 0;	// horrible syntax trick to make the compiler happy about %llu
     if(TIXML_SSCANF(str, IsPrefixHex(str) ? "%llx" : "%llu", &v) == 1) {
         *value = (uint64_t)v;
@@ -718,7 +947,7 @@ char* XMLDocument::Identify( char* p, XMLNode** node, bool first )
     TIXMLASSERT( p );
     char* const start = p;
     int const startLine = _parseCurLineNum;
-    p = XMLUtil::SkipWhiteSpace( p, &_parseCurLineNum );
+    p = XMLUtil::SkipWhiteSpace( p, ParseLineCounter() );
     if( !*p ) {
         *node = 0;
         TIXMLASSERT( p );
@@ -1254,6 +1483,9 @@ char* XMLText::ParseDeep( char* p, StrPair*, int* curLineNumPtr )
     }
     else {
         int flags = _document->ProcessEntities() ? StrPair::TEXT_ELEMENT : StrPair::TEXT_ELEMENT_LEAVE_ENTITIES;
+        if ( _document->GetParseProfile() == MACHINE_GENERATED_PARSE ) {
+            flags = 0;
+        }
         if ( _document->WhitespaceMode() == COLLAPSE_WHITESPACE ) {
             flags |= StrPair::NEEDS_WHITESPACE_COLLAPSING;
         }
@@ -1452,7 +1684,7 @@ const char* XMLAttribute::Value() const
     return _value.GetStr();
 }
 
-char* XMLAttribute::ParseDeep( char* p, bool processEntities, int* curLineNumPtr )
+char* XMLAttribute::ParseDeep( char* p, int valueFlags, int* curLineNumPtr )
 {
     // Parse using the name rules: bug fix, was using ParseText before
     p = _name.ParseName( p );
@@ -1475,7 +1707,7 @@ char* XMLAttribute::ParseDeep( char* p, bool processEntities, int* curLineNumPtr
     const char endTag[2] = { *p, 0 };
     ++p;	// move past opening quote
 
-    p = _value.ParseText( p, endTag, processEntities ? StrPair::ATTRIBUTE_VALUE : StrPair::ATTRIBUTE_VALUE_LEAVE_ENTITIES, curLineNumPtr );
+    p = _value.ParseText( p, endTag, valueFlags, curLineNumPtr );
     return p;
 }
 
@@ -1972,6 +2204,10 @@ void XMLElement::DeleteAttribute( const char* name )
 char* XMLElement::ParseAttributes( char* p, int* curLineNumPtr )
 {
     XMLAttribute* prevAttribute = 0;
+    int valueFlags = _document->ProcessEntities() ? StrPair::ATTRIBUTE_VALUE : StrPair::ATTRIBUTE_VALUE_LEAVE_ENTITIES;
+    if ( _document->GetParseProfile() == MACHINE_GENERATED_PARSE ) {
+        valueFlags = 0;
+    }
 
     // Read the attributes.
     while( p ) {
@@ -1989,7 +2225,7 @@ char* XMLElement::ParseAttributes( char* p, int* curLineNumPtr )
 
             const int attrLineNum = attrib->_parseLineNum;
 
-            p = attrib->ParseDeep( p, _document->ProcessEntities(), curLineNumPtr );
+            p = attrib->ParseDeep( p, valueFlags, curLineNumPtr );
             if ( !p || Attribute( attrib->Name() ) ) {
                 DeleteAttribute( attrib );
                 _document->SetError( XML_ERROR_PARSING_ATTRIBUTE, attrLineNum, "XMLElement name=%s", Name() );
@@ -2199,9 +2435,11 @@ XMLDocument::XMLDocument( bool processEntities, Whitespace whitespaceMode ) :
     _processEntities( processEntities ),
     _errorID(XML_SUCCESS),
     _whitespaceMode( whitespaceMode ),
+    _parseProfile( STANDARD_PARSE ),
     _errorStr(),
     _errorLineNum( 0 ),
     _charBuffer( 0 ),
+    _charBufferOwned( true ),
     _parseCurLineNum( 0 ),
 	_parsingDepth(0),
     _unlinked(),
@@ -2246,8 +2484,11 @@ void XMLDocument::Clear()
 #endif
     ClearError();
 
-    delete [] _charBuffer;
+    if ( _charBufferOwned ) {
+        delete [] _charBuffer;
+    }
     _charBuffer = 0;
+    _charBufferOwned = true;
 	_parsingDepth = 0;
 
 #if 0
@@ -2265,6 +2506,47 @@ void XMLDocument::Clear()
         TIXMLASSERT( _commentPool.CurrentAllocs()   == _commentPool.Untracked() );
     }
 #endif
+
+    // Every node is gone: the next nodes come from the start of the blocks again
+    _elementPool.Reset();
+    _attributePool.Reset();
+    _textPool.Reset();
+    _commentPool.Reset();
+}
+
+
+void XMLDocument::SetPoolBlockSize( size_t bytes, bool hugePages )
+{
+    _elementPool.SetBlockSize( bytes, hugePages );
+    _attributePool.SetBlockSize( bytes, hugePages );
+    _textPool.SetBlockSize( bytes, hugePages );
+    _commentPool.SetBlockSize( bytes, hugePages );
+}
+
+
+MemPoolStats XMLDocument::PoolStats() const
+{
+    const MemPoolStats pools[] = { _elementPool.Stats(), _attributePool.Stats(), _textPool.Stats(), _commentPool.Stats() };
+    MemPoolStats stats;
+    for ( const MemPoolStats& pool : pools ) {
+        stats.blocks += pool.blocks;
+        stats.blockBytes += pool.blockBytes;
+        stats.items += pool.items;
+        stats.peakItems += pool.peakItems;
+        stats.peakItemBytes += pool.peakItemBytes;
+        stats.allocations += pool.allocations;
+    }
+    return stats;
+}
+
+
+void XMLDocument::ReleasePoolMemory()
+{
+    Clear();
+    _elementPool.Clear();
+    _attributePool.Clear();
+    _textPool.Clear();
+    _commentPool.Clear();
 }
 
 
@@ -2423,6 +2705,12 @@ XMLError XMLDocument::LoadFile( FILE* fp )
     _charBuffer[size] = 0;
 
     Parse();
+    if ( Error() && _parseProfile == MACHINE_GENERATED_PARSE ) {
+        // Read the file again counting lines, so the error has its location
+        _parseProfile = STANDARD_PARSE;
+        LoadFile( fp );
+        _parseProfile = MACHINE_GENERATED_PARSE;
+    }
     return _errorID;
 }
 
@@ -2475,19 +2763,59 @@ XMLError XMLDocument::Parse( const char* xml, size_t nBytes )
 
     Parse();
     if ( Error() ) {
-        // clean up now essentially dangling memory.
-        // and the parse fail can put objects in the
-        // pools that are dead and inaccessible.
-        DeleteChildren();
-        _elementPool.Clear();
-        _attributePool.Clear();
-        _textPool.Clear();
-        _commentPool.Clear();
+        ClearAfterParseError();
+        if ( _parseProfile == MACHINE_GENERATED_PARSE ) {
+            // Parse the text again counting lines, so the error has its location
+            _parseProfile = STANDARD_PARSE;
+            Parse( xml, nBytes );
+            _parseProfile = MACHINE_GENERATED_PARSE;
+        }
+    }
+    return _errorID;
+}
+
+
+XMLError XMLDocument::ParseInSitu( char* xml, size_t nBytes )
+{
+    Clear();
+
+    if ( nBytes == 0 || !xml || !*xml ) {
+        SetError( XML_ERROR_EMPTY_DOCUMENT, 0, 0 );
+        return _errorID;
+    }
+    if ( nBytes == static_cast<size_t>(-1) ) {
+        nBytes = strlen( xml );
+    }
+    TIXMLASSERT( _charBuffer == 0 );
+    _charBuffer = xml;
+    _charBufferOwned = false;
+    _charBuffer[nBytes] = 0;
+
+    Parse();
+    if ( Error() ) {
+        ClearAfterParseError();
     }
     return _errorID;
 }
 
 
+void XMLDocument::ClearAfterParseError()
+{
+    // clean up now essentially dangling memory.
+    // and the parse fail can put objects in the
+    // pools that are dead and inaccessible.
+    // The blocks are kept for the next parse.
+    DeleteChildren();
+	while( _unlinked.Size()) {
+		DeleteNode(_unlinked[0]);	// Will remove from _unlinked as part of delete.
+	}
+    _elementPool.Reset();
+    _attributePool.Reset();
+    _textPool.Reset();
+    _commentPool.Reset();
+}
+
+
 void XMLDocument::Print( XMLPrinter* streamer ) const
 {
     if ( streamer ) {
@@ -2563,16 +2891,17 @@ void XMLDocument::Parse()
 {
     TIXMLASSERT( NoChildren() ); // Clear() must have been called previously
     TIXMLASSERT( _charBuffer );
-    _parseCurLineNum = 1;
-    _parseLineNum = 1;
+    // Lines are numbered from 1, 0 when they are not counted
+    _parseCurLineNum = _parseProfile == STANDARD_PARSE ? 1 : 0;
+    _parseLineNum = _parseCurLineNum;
     char* p = _charBuffer;
-    p = XMLUtil::SkipWhiteSpace( p, &_parseCurLineNum );
+    p = XMLUtil::SkipWhiteSpace( p, ParseLineCounter() );
     p = const_cast<char*>( XMLUtil::ReadBOM( p, &_writeBOM ) );
     if ( !*p ) {
         SetError( XML_ERROR_EMPTY_DOCUMENT, 0, 0 );
         return;
     }
-    ParseDeep(p, 0, &_parseCurLineNum );
+    ParseDeep(p, 0, ParseLineCounter() );
 }
 
 void XMLDocument::PushDepth()
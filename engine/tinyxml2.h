@@ -320,11 +320,27 @@ private:
 };
 
 
+/*
+	Allocation statistics of a pool, to size its blocks.
+*/
+struct MemPoolStats
+{
+    int		blocks;			// blocks held
+    size_t	blockBytes;		// memory of the blocks
+    int		items;			// items in use
+    int		peakItems;		// most items in use at once since the pool was cleared
+    size_t	peakItemBytes;
+    int		allocations;	// items handed out since the pool was cleared
+
+    MemPoolStats() : blocks( 0 ), blockBytes( 0 ), items( 0 ), peakItems( 0 ), peakItemBytes( 0 ), allocations( 0 ) {}
+};
+
+
 /*
 	Parent virtual class of a pool for fast allocation
 	and deallocation of objects.
 */
-class MemPool
+class TINYXML2_LIB MemPool
 {
 public:
     MemPool() {}
@@ -334,17 +350,34 @@ public:
     virtual void* Alloc() = 0;
     virtual void Free( void* ) = 0;
     virtual void SetTracked() = 0;
+
+    // Huge page blocks are rounded up to a multiple of this
+    static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+protected:
+    // Memory of a block. With 'hugePages' set, it is asked for huge pages and the
+    // flag is cleared if the system gave ordinary memory; pass it back to FreeBlock.
+    static void* AllocBlock( size_t size, bool* hugePages );
+    static void FreeBlock( void* block, size_t size, bool hugePages );
 };
 
 
 /*
 	Template child class to create pools of the correct type.
+
+	Items come from blocks (an arena): freed items are reused first,
+	then the unused items of the blocks in order, then a new block.
+	Reset() makes every item unused again and keeps the blocks, so a
+	document parsed again allocates no memory until it outgrows the
+	previous one. Clear() frees the blocks.
 */
 template< int ITEM_SIZE >
 class MemPoolT : public MemPool
 {
 public:
-    MemPoolT() : _blockPtrs(), _root(0), _currentAllocs(0), _nAllocs(0), _maxAllocs(0), _nUntracked(0)	{}
+    MemPoolT() : _blockPtrs(), _root(0), _currentBlock(-1), _currentBlockUsed(0),
+                 _blockSize( ITEMS_PER_BLOCK * sizeof( Item ) ), _hugePages(false),
+                 _currentAllocs(0), _nAllocs(0), _maxAllocs(0), _nUntracked(0)	{}
     ~MemPoolT() {
         MemPoolT< ITEM_SIZE >::Clear();
     }
@@ -352,16 +385,35 @@ public:
     void Clear() {
         // Delete the blocks.
         while( !_blockPtrs.Empty()) {
-            Block* lastBlock = _blockPtrs.Pop();
-            delete lastBlock;
+            Block lastBlock = _blockPtrs.Pop();
+            FreeBlock( lastBlock.items, lastBlock.bytes, lastBlock.hugePages );
         }
-        _root = 0;
-        _currentAllocs = 0;
+        Reset();
         _nAllocs = 0;
         _maxAllocs = 0;
+    }
+
+    // Every item becomes unused (items still allocated are lost); the blocks stay
+    void Reset() {
+        _root = 0;
+        _currentBlock = -1;
+        _currentBlockUsed = 0;
+        _currentAllocs = 0;
         _nUntracked = 0;
     }
 
+    // Size in bytes of the blocks allocated from now on, optionally backed by huge pages
+    void SetBlockSize( size_t bytes, bool hugePages ) {
+        if ( bytes < sizeof( Item ) ) {
+            bytes = sizeof( Item );
+        }
+        if ( hugePages ) {
+            bytes = ( bytes + HUGE_PAGE_SIZE - 1 ) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+        }
+        _blockSize = bytes;
+        _hugePages = hugePages;
+    }
+
     virtual int ItemSize() const override{
         return ITEM_SIZE;
     }
@@ -370,21 +422,28 @@ public:
     }
 
     virtual void* Alloc() override{
-        if ( !_root ) {
-            // Need a new block.
-            Block* block = new Block;
-            _blockPtrs.Push( block );
-
-            Item* blockItems = block->items;
-            for( int i = 0; i < ITEMS_PER_BLOCK - 1; ++i ) {
-                blockItems[i].next = &(blockItems[i + 1]);
+        Item* result = _root;
+        if ( result ) {
+            _root = _root->next;
+        }
+        else {
+            // Next unused item, from the next block (a new one if none is left) when this one is used up
+            if ( _currentBlock < 0 || _currentBlockUsed == _blockPtrs[_currentBlock].itemCount ) {
+                ++_currentBlock;
+                _currentBlockUsed = 0;
+                if ( _currentBlock == _blockPtrs.Size() ) {
+                    Block block;
+                    block.hugePages = _hugePages;
+                    block.items = static_cast<Item*>( AllocBlock( _blockSize, &block.hugePages ) );
+                    block.itemCount = static_cast<int>( _blockSize / sizeof( Item ) );
+                    block.bytes = _blockSize;
+                    _blockPtrs.Push( block );
+                }
             }
-            blockItems[ITEMS_PER_BLOCK - 1].next = 0;
-            _root = blockItems;
+            result = _blockPtrs[_currentBlock].items + _currentBlockUsed;
+            ++_currentBlockUsed;
         }
-        Item* const result = _root;
         TIXMLASSERT( result != 0 );
-        _root = _root->next;
 
         ++_currentAllocs;
         if ( _currentAllocs > _maxAllocs ) {
@@ -413,6 +472,19 @@ public:
                 ITEM_SIZE, _nAllocs, _blockPtrs.Size() );
     }
 
+    MemPoolStats Stats() const {
+        MemPoolStats stats;
+        stats.blocks = _blockPtrs.Size();
+        for( int i = 0; i < _blockPtrs.Size(); ++i ) {
+            stats.blockBytes += _blockPtrs[i].bytes;
+        }
+        stats.items = _currentAllocs;
+        stats.peakItems = _maxAllocs;
+        stats.peakItemBytes = static_cast<size_t>( _maxAllocs ) * sizeof( Item );
+        stats.allocations = _nAllocs;
+        return stats;
+    }
+
     void SetTracked() override {
         --_nUntracked;
     }
@@ -421,7 +493,7 @@ public:
         return _nUntracked;
     }
 
-	// This number is perf sensitive. 4k seems like a good tradeoff on my machine.
+	// Default block size. This number is perf sensitive. 4k seems like a good tradeoff on my machine.
 	// The test file is large, 170k.
 	// Release:		VS2010 gcc(no opt)
 	//		1k:		4000
@@ -443,10 +515,17 @@ private:
         char    itemData[static_cast<size_t>(ITEM_SIZE)];
     };
     struct Block {
-        Item items[ITEMS_PER_BLOCK];
+        Item*	items;
+        int		itemCount;
+        size_t	bytes;
+        bool	hugePages;
     };
-    DynArray< Block*, 10 > _blockPtrs;
-    Item* _root;
+    DynArray< Block, 10 > _blockPtrs;
+    Item* _root;			// freed items
+    int _currentBlock;		// block the unused items are taken from, -1 before the first
+    int _currentBlockUsed;	// items of it handed out
+    size_t _blockSize;
+    bool _hugePages;
 
     int _currentAllocs;
     int _nAllocs;
@@ -1250,7 +1329,7 @@ private:
     void operator=( const XMLAttribute& );	// not supported
     void SetName( const char* name );
 
-    char* ParseDeep( char* p, bool processEntities, int* curLineNumPtr );
+    char* ParseDeep( char* p, int valueFlags, int* curLineNumPtr );
 
     mutable StrPair _name;
     mutable StrPair _value;
@@ -1711,6 +1790,11 @@ enum Whitespace {
     PEDANTIC_WHITESPACE
 };
 
+enum ParseProfile {
+    STANDARD_PARSE,
+    MACHINE_GENERATED_PARSE
+};
+
 
 /** A Document binds together all the functionality.
 	It can be saved, loaded, and printed to the screen.
@@ -1753,6 +1837,21 @@ public:
     */
     XMLError Parse( const char* xml, size_t nBytes=static_cast<size_t>(-1) );
 
+    /**
+    	Parse an XML file in place, in a buffer owned by the caller,
+    	without copying it. Returns XML_SUCCESS (0) on success, or
+    	an errorID.
+
+    	The document borrows the buffer: parsing writes into it
+    	(terminators, normalized text) and the nodes point into it,
+    	so it must stay writable and alive until the document is
+    	cleared, parsed again or deleted. It must hold nBytes+1
+    	characters; xml[nBytes] is set to 0. If 'nBytes' is not
+    	specified, 'xml' must be a null terminated string.
+    	A private (copy-on-write) memory map of a file works.
+    */
+    XMLError ParseInSitu( char* xml, size_t nBytes=static_cast<size_t>(-1) );
+
     /**
     	Load an XML file from disk.
     	Returns XML_SUCCESS (0) on success, or
@@ -1796,6 +1895,25 @@ public:
         return _whitespaceMode;
     }
 
+    /**
+    	MACHINE_GENERATED_PARSE is for input written by programs
+    	(such as model files): the parser does not count lines,
+    	and attribute values and text are taken as they are, with
+    	no entities and no newline normalization. GetLineNum()
+    	returns 0 for the nodes and attributes. When such a parse
+    	fails, Parse() and LoadFile() parse the text again with
+    	STANDARD_PARSE to report the error with its line.
+    	ParseInSitu() cannot,
+    	its buffer was written to: the error has no line (0) and
+    	the caller may parse a fresh copy of the text again.
+    */
+    void SetParseProfile( ParseProfile profile )	{
+        _parseProfile = profile;
+    }
+    ParseProfile GetParseProfile() const	{
+        return _parseProfile;
+    }
+
     /**
     	Returns true if this document has a leading Byte Order Mark of UTF8.
     */
@@ -1907,8 +2025,25 @@ public:
     }
 
     /// Clear the document, resetting it to the initial state.
+    /// The memory of the node pools is kept for the next parse.
     void Clear();
 
+    /**
+    	Size in bytes of the blocks the node pools allocate from
+    	now on (4k by default). Fewer, larger blocks suit large
+    	documents. With 'hugePages' the blocks are rounded up to
+    	whole huge pages and backed by them where the system allows
+    	(Linux: reserved huge pages, else transparent huge pages);
+    	elsewhere it is ignored.
+    */
+    void SetPoolBlockSize( size_t bytes, bool hugePages = false );
+
+    /// Allocation statistics of the node pools, summed.
+    MemPoolStats PoolStats() const;
+
+    /// Clear the document and free the memory of the node pools.
+    void ReleasePoolMemory();
+
 	/**
 		Copies this document to a target document.
 		The target will be completely cleared before the copy.
@@ -1939,9 +2074,11 @@ private:
     bool			_processEntities;
     XMLError		_errorID;
     Whitespace		_whitespaceMode;
+    ParseProfile	_parseProfile;
     mutable StrPair	_errorStr;
     int             _errorLineNum;
     char*			_charBuffer;
+    bool			_charBufferOwned;	// false while parsing a buffer of the caller (ParseInSitu)
     int				_parseCurLineNum;
 	int				_parsingDepth;
 	// Memory tracking does add some overhead.
@@ -1960,6 +2097,12 @@ private:
 	static const char* _errorNames[XML_ERROR_COUNT];
 
     void Parse();
+    void ClearAfterParseError();
+
+    // Line counter the parser updates, none in MACHINE_GENERATED_PARSE
+    int* ParseLineCounter()	{
+        return _parseProfile == STANDARD_PARSE ? &_parseCurLineNum : 0;
+    }
 
     void SetError( XMLError error, int lineNum, const char* format, ... );
 
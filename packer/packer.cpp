@@ -0,0 +1,67 @@
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+#include "engine/assetpack.h"
+#include "engine/resources.h"
+#include "engine/scenefile.h"
+
+using namespace std;
+
+// Bundle a world XML file into an asset pack: its compiled scene and every model file it uses
+int main(int argc, char* argv[]) {
+    // Model files are found like the engine does: the given directories, then files3d
+    ResourceManager resources;
+    int argument = 1;
+    while (argc - argument > 2 && string(argv[argument]) == "--search-path") {
+        resources.addSearchPath(argv[argument + 1]);
+        argument += 2;
+    }
+    if (argc - argument != 2) {
+        cerr << "Usage: " << argv[0] << " [--search-path DIR]... <config.xml> <world.pack>" << endl;
+        return 1;
+    }
+    resources.addSearchPath(ResourceManager::DEFAULT_SEARCH_PATH);
+    string xmlFile = argv[argument];
+    string packFile = argv[argument + 1];
+
+    vector<AssetPack::Entry> entries(1);
+    entries[0].name = AssetPack::SCENE_ENTRY;
+    if (!SceneFile::compile(xmlFile, entries[0].data)) {
+        return 1;
+    }
+
+    // The model file names come from the compiled scene, as the engine will see them
+    Window window;
+    Camera camera;
+    Scene scene;
+    const vector<char>& sceneData = entries[0].data;
+    if (SceneFile::load(sceneData.data(), sceneData.size(), xmlFile, window, camera, scene, nullptr) != SCENE_FILE_OK) {
+        return 1;
+    }
+
+    // Entries are named as the scene refers to the models
+    size_t modelBytes = 0;
+    for (const string& modelFile : scene.modelFiles) {
+        string path = resources.resolve(modelFile);
+        ifstream file(path, ios::binary);
+        if (!file.is_open()) {
+            cerr << "Error opening model file: " << path << endl;
+            return 1;
+        }
+        AssetPack::Entry entry;
+        entry.name = modelFile;
+        entry.data.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+        modelBytes += entry.data.size();
+        entries.push_back(move(entry));
+    }
+
+    if (!AssetPack::write(packFile, entries)) {
+        return 1;
+    }
+    cout << "Asset pack written to " << packFile << ": scene and " << scene.modelFiles.size() << " model files ("
+         << modelBytes / 1024 << " KB)" << endl;
+    return 0;
+}